@@ -0,0 +1,430 @@
+/*
+ * Microbenchmarks for Penguins Game.
+ * Times the hot board, render and save primitives one at a time on seeded
+ * boards of several sizes. Each benchmark first finds an iteration count
+ * that fills one sample (-t ms), then takes -n samples of it and reports
+ * the mean, standard deviation, minimum and maximum time per call. The
+ * board for every size comes from the same seed, with one penguin per
+ * player already placed, so two runs measure the same work.
+ *
+ * Usage: penguin-bench [-s seed] [-n samples] [-t ms] [-f filter]
+ *                      [-o results.tsv] [-c baseline.tsv] [size...]
+ * A size is N (an NxN board) or ROWSxCOLS; the default sizes are 10x10,
+ * 100x100 and 1000x1000. -o writes the results as tab-separated values and
+ * -c compares the means with an earlier -o file; -f runs only the
+ * benchmarks whose name contains the filter.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "board.h"
+#include "players.h"
+#include "game.h"
+#include "render.h"
+#include "rng.h"
+#include "scan.h"
+
+#define BENCH_SAMPLES   10
+#define BENCH_SAMPLE_MS 20
+#define BENCH_MAX_SIZES 16
+#define BENCH_PLAYERS   4
+
+// File save_game and load_game use, removed at the end
+#define BENCH_SAVE_FILE "penguin-bench.dat"
+
+static const char *default_sizes[] = { "10", "100", "1000" };
+
+// Everything the benchmarks work on for one board size.
+typedef struct {
+    int rows, cols;
+    uint64_t seed;
+    Board *board;               // seeded board with every player's penguin placed
+    Board *scratch;             // same size, for init_board
+    Player players[BENCH_PLAYERS];
+    Game game;
+    Renderer *view;
+    Rng rng;
+    int probe;                  // cycles through players and directions between calls
+} BenchState;
+
+// One benchmark: runs its primitive iters times and returns something derived from the results
+typedef struct {
+    const char *name;
+    long (*run)(BenchState *st, long iters);
+} Bench;
+
+// One result row.
+typedef struct {
+    char name[32];
+    char size[24];
+    double mean, sd, min, max;  // ns per call
+    long iters;                 // calls per sample
+} BenchResult;
+
+// Keeps the compiler from dropping the benchmark loops
+static volatile long sink;
+
+// Print usage and exit
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-s seed] [-n samples] [-t ms] [-f filter]\n"
+                    "       [-o results.tsv] [-c baseline.tsv] [size...]\n"
+                    "size: N or ROWSxCOLS, sides 1-%d\n", prog, BOARD_MAX_SIDE);
+    exit(1);
+}
+
+// Monotonic time in nanoseconds
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Read N or ROWSxCOLS
+static int parse_size(const char *arg, int *rows, int *cols)
+{
+    char tail;
+    if (sscanf(arg, "%dx%d%c", rows, cols, &tail) != 2)
+    {
+        if (sscanf(arg, "%d%c", rows, &tail) != 1)
+            return 0;
+        *cols = *rows;
+    }
+    return *rows >= 1 && *rows <= BOARD_MAX_SIDE && *cols >= 1 && *cols <= BOARD_MAX_SIDE;
+}
+
+// Player id and tile of the penguin the next probe uses
+static int next_penguin(BenchState *st, int *r, int *c)
+{
+    int id = st->probe++ % BENCH_PLAYERS + 1;
+    if (!find_penguin(st->board, id, r, c))
+        *r = *c = 0;
+    return id;
+}
+
+static long run_create_free(BenchState *st, long iters)
+{
+    long i, sum = 0;
+    for (i = 0; i < iters; i++)
+    {
+        Board *b = create_board(st->rows, st->cols);
+        sum += b != NULL;
+        free_board(b);
+    }
+    return sum;
+}
+
+static long run_init_board(BenchState *st, long iters)
+{
+    long i;
+    for (i = 0; i < iters; i++)
+        init_board(st->scratch, &st->rng);
+    return st->scratch->placeable;
+}
+
+static long run_can_place(BenchState *st, long iters)
+{
+    long i, sum = 0;
+    for (i = 0; i < iters; i++)
+        sum += can_place(st->board);
+    return sum;
+}
+
+static long run_find_penguin(BenchState *st, long iters)
+{
+    long i, sum = 0;
+    int r = 0, c = 0;
+    for (i = 0; i < iters; i++)
+        sum += find_penguin(st->board, (int)(i % BENCH_PLAYERS) + 1, &r, &c) + r;
+    return sum;
+}
+
+static long run_player_can_move(BenchState *st, long iters)
+{
+    long i, sum = 0;
+    for (i = 0; i < iters; i++)
+        sum += player_can_move(st->board, (int)(i % BENCH_PLAYERS) + 1);
+    return sum;
+}
+
+// Each call checks one of the four neighbours of one penguin, so legal and illegal moves mix
+static long run_is_valid_move(BenchState *st, long iters)
+{
+    static const int dr[4] = { -1, 1, 0, 0 }, dc[4] = { 0, 0, -1, 1 };
+    long i, sum = 0;
+    for (i = 0; i < iters; i++)
+    {
+        int r, c, id = next_penguin(st, &r, &c), d = (int)(i / BENCH_PLAYERS % 4);
+        sum += is_valid_move(st->board, id, r, c, r + dr[d], c + dc[d]);
+    }
+    return sum;
+}
+
+static long run_find_best_move(BenchState *st, long iters)
+{
+    long i, sum = 0;
+    Move m;
+    for (i = 0; i < iters; i++)
+        sum += find_best_adjacent_move(st->board, (int)(i % BENCH_PLAYERS) + 1, &m);
+    return sum;
+}
+
+// Output goes to /dev/null, so every frame is the plain full board (or its window)
+static long run_print_board(BenchState *st, long iters)
+{
+    long i;
+    for (i = 0; i < iters; i++)
+        render_board(st->view, st->board, st->board->penguins[1][0]);
+    return iters;
+}
+
+static long run_save_game(BenchState *st, long iters)
+{
+    long i, sum = 0;
+    for (i = 0; i < iters; i++)
+        sum += save_game(BENCH_SAVE_FILE, &st->game);
+    return sum;
+}
+
+static long run_load_game(BenchState *st, long iters)
+{
+    long i, sum = 0;
+    (void)st;
+    for (i = 0; i < iters; i++)
+    {
+        Game loaded;
+        if (!load_game(BENCH_SAVE_FILE, &loaded))
+            continue;
+        sum += loaded.board->placeable;
+        free_board(loaded.board);
+        free(loaded.players);
+    }
+    return sum;
+}
+
+static const Bench benches[] = {
+    { "create_free",  run_create_free },
+    { "init_board",   run_init_board },
+    { "can_place",    run_can_place },
+    { "find_penguin", run_find_penguin },
+    { "player_can_move", run_player_can_move },
+    { "is_valid_move", run_is_valid_move },
+    { "find_best_move", run_find_best_move },
+    { "print_board",  run_print_board },
+    { "save_game",    run_save_game },
+    { "load_game",    run_load_game },
+};
+
+// Seeded board with one penguin per player on the first placement tiles
+static int setup_state(BenchState *st, int rows, int cols, uint64_t seed)
+{
+    int i, r, c;
+
+    memset(st, 0, sizeof(*st));
+    st->rows = rows;
+    st->cols = cols;
+    st->seed = seed;
+    st->board = create_board(rows, cols);
+    st->scratch = create_board(rows, cols);
+    st->view = renderer_create();
+    if (!st->board || !st->scratch || !st->view)
+        return 0;
+
+    rng_seed(&st->rng, seed);
+    init_board(st->board, &st->rng);
+    for (i = 0; i < BENCH_PLAYERS; i++)
+    {
+        st->players[i].is_ai = AI_GREEDY;
+        snprintf(st->players[i].name, sizeof(st->players[i].name), "AI%d", i + 1);
+    }
+    reset_players(st->players, BENCH_PLAYERS, 1);
+    init_game(&st->game, st->board, st->players, BENCH_PLAYERS, MODE_PVP);
+    st->game.quiet = 1;
+    st->game.seed = seed;
+    for (i = 0; i < BENCH_PLAYERS && find_first_placement(st->board, &r, &c); i++)
+        game_place_penguin(&st->game, i, r, c);
+
+    // load_game needs a file from the first sample on
+    return save_game(BENCH_SAVE_FILE, &st->game);
+}
+
+static void free_state(BenchState *st)
+{
+    free_board(st->board);
+    free_board(st->scratch);
+    renderer_free(st->view);
+}
+
+// Calls per sample: double until one batch takes at least a tenth of the sample time
+static long calibrate(const Bench *b, BenchState *st, long long sample_ns)
+{
+    long iters = 1;
+    for (;;)
+    {
+        long long t0 = now_ns(), dt;
+        sink += b->run(st, iters);
+        dt = now_ns() - t0;
+        if (dt >= sample_ns / 10 || iters >= (1L << 40))
+            return dt > 0 ? (long)((double)iters * sample_ns / dt) + 1 : iters;
+        iters *= 2;
+    }
+}
+
+// Time one benchmark: samples of iters calls each
+static void measure(const Bench *b, BenchState *st, int samples, long long sample_ns, BenchResult *res)
+{
+    double sum = 0, sq = 0;
+    int i;
+
+    res->iters = calibrate(b, st, sample_ns);
+    res->min = INFINITY;
+    res->max = 0;
+    for (i = 0; i < samples; i++)
+    {
+        long long t0 = now_ns();
+        double ns;
+        sink += b->run(st, res->iters);
+        ns = (double)(now_ns() - t0) / res->iters;
+        sum += ns;
+        sq += ns * ns;
+        if (ns < res->min) res->min = ns;
+        if (ns > res->max) res->max = ns;
+    }
+    res->mean = sum / samples;
+    res->sd = samples > 1 ? sqrt(fmax(0.0, (sq - sum * sum / samples) / (samples - 1))) : 0.0;
+}
+
+// Mean of the same benchmark and size in a baseline file, or -1
+static double baseline_mean(FILE *fp, const char *name, const char *size)
+{
+    char line[256], bname[32], bsize[24];
+    double mean;
+
+    if (!fp) return -1;
+    rewind(fp);
+    while (fgets(line, sizeof(line), fp))
+        if (sscanf(line, "%31s %23s %lf", bname, bsize, &mean) == 3 &&
+            strcmp(bname, name) == 0 && strcmp(bsize, size) == 0)
+            return mean;
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    BenchResult results[sizeof(benches) / sizeof(benches[0]) * BENCH_MAX_SIZES];
+    const char **sizes = default_sizes;
+    int num_sizes = (int)(sizeof(default_sizes) / sizeof(default_sizes[0]));
+    int samples = BENCH_SAMPLES, sample_ms = BENCH_SAMPLE_MS;
+    const char *filter = NULL, *out_file = NULL, *base_file = NULL;
+    FILE *base = NULL, *report;
+    uint64_t seed = 1;
+    int rows, cols, i, s, count = 0, stdout_fd;
+    size_t b;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++)
+    {
+        if (i + 1 >= argc) usage(argv[0]);
+        if (strcmp(argv[i], "-s") == 0) seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-n") == 0) samples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-t") == 0) sample_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-f") == 0) filter = argv[++i];
+        else if (strcmp(argv[i], "-o") == 0) out_file = argv[++i];
+        else if (strcmp(argv[i], "-c") == 0) base_file = argv[++i];
+        else usage(argv[0]);
+    }
+    if (samples < 1 || sample_ms < 1)
+        usage(argv[0]);
+    if (i < argc)
+    {
+        sizes = (const char **)(argv + i);
+        num_sizes = argc - i;
+    }
+    if (num_sizes > BENCH_MAX_SIZES)
+        usage(argv[0]);
+    for (i = 0; i < num_sizes; i++)
+        if (!parse_size(sizes[i], &rows, &cols))
+            usage(argv[0]);
+    if (base_file && !(base = fopen(base_file, "r")))
+    {
+        fprintf(stderr, "Cannot open %s.\n", base_file);
+        return 1;
+    }
+
+    // frames go to /dev/null; the report is written to the real stdout through a duplicate
+    fflush(stdout);
+    stdout_fd = dup(STDOUT_FILENO);
+    i = open("/dev/null", O_WRONLY);
+    report = stdout_fd >= 0 ? fdopen(stdout_fd, "w") : NULL;
+    if (!report || i < 0 || dup2(i, STDOUT_FILENO) < 0)
+    {
+        fprintf(stderr, "Cannot redirect output to /dev/null.\n");
+        return 1;
+    }
+    close(i);
+
+    fprintf(report, "seed %llu, %d samples of %d ms, %s scan kernels\n\n", (unsigned long long)seed,
+            samples, sample_ms, scan_level_name(scan_level()));
+    fprintf(report, "%-16s %-10s %12s %10s %6s %12s %12s%s\n", "benchmark", "board", "ns/op", "sd", "cv%",
+            "min", "max", base ? "   vs base" : "");
+    for (s = 0; s < num_sizes; s++)
+    {
+        BenchState st;
+
+        parse_size(sizes[s], &rows, &cols);
+        if (!setup_state(&st, rows, cols, seed))
+        {
+            fprintf(stderr, "Cannot set up a %dx%d board.\n", rows, cols);
+            return 1;
+        }
+        for (b = 0; b < sizeof(benches) / sizeof(benches[0]); b++)
+        {
+            BenchResult *res = &results[count];
+            double old;
+
+            if (filter && !strstr(benches[b].name, filter))
+                continue;
+            snprintf(res->name, sizeof(res->name), "%s", benches[b].name);
+            snprintf(res->size, sizeof(res->size), "%dx%d", rows, cols);
+            measure(&benches[b], &st, samples, sample_ms * 1000000LL, res);
+            count++;
+
+            fprintf(report, "%-16s %-10s %12.1f %10.1f %6.1f %12.1f %12.1f", res->name, res->size, res->mean,
+                    res->sd, res->mean > 0 ? 100.0 * res->sd / res->mean : 0.0, res->min, res->max);
+            old = baseline_mean(base, res->name, res->size);
+            if (old > 0)
+                fprintf(report, " %+9.1f%%", 100.0 * (res->mean - old) / old);
+            fprintf(report, "\n");
+            fflush(report);
+        }
+        free_state(&st);
+    }
+    unlink(BENCH_SAVE_FILE);
+    fclose(report);
+    if (base)
+        fclose(base);
+
+    if (out_file)
+    {
+        FILE *fp = fopen(out_file, "w");
+        if (!fp)
+        {
+            fprintf(stderr, "Cannot write %s.\n", out_file);
+            return 1;
+        }
+        fprintf(fp, "# benchmark\tboard\tns_per_op\tsd\tmin\tmax\titers\tsamples\tseed\n");
+        for (i = 0; i < count; i++)
+            fprintf(fp, "%s\t%s\t%.2f\t%.2f\t%.2f\t%.2f\t%ld\t%d\t%llu\n", results[i].name, results[i].size,
+                    results[i].mean, results[i].sd, results[i].min, results[i].max, results[i].iters,
+                    samples, (unsigned long long)seed);
+        fclose(fp);
+    }
+    return 0;
+}
@@ -0,0 +1,30 @@
+/* This file contains the helpers that size, clear and scan the board's bit planes.
+   The per-tile updates and neighbour checks are inline in bitboard.h. */
+
+#include <string.h>
+#include "bitboard.h"
+#include "scan.h"
+
+// Number of 64-bit words one plane needs, including the guard column and guard rows
+int bitboard_words(int rows, int cols)
+{
+    long bits = (long)(rows + 2) * (cols + 1);
+    return (int)((bits + 63) / 64);
+}
+
+// Attach the three planes to caller storage and clear them
+void bitboard_init(Bitboard *bb, int rows, int cols, uint64_t *storage)
+{
+    bb->stride = cols + 1;
+    bb->words = bitboard_words(rows, cols);
+    bb->ice = storage;
+    bb->occupied = storage + bb->words;
+    bb->one_fish = storage + 2 * bb->words;
+    memset(storage, 0, 3 * (size_t)bb->words * sizeof(uint64_t));
+}
+
+// Scan the planes for a 1-fish tile without a penguin, 64 to 256 tiles per step
+int bitboard_first_placeable(const Bitboard *bb)
+{
+    return scan_first_andnot(bb->one_fish, bb->occupied, bb->words);
+}
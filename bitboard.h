@@ -0,0 +1,73 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+// This header defines the bit planes the board keeps next to its tiles.
+// Every plane is a row-major bit set with one guard column on the right and
+// one guard row above and below the board, so the four neighbours of any
+// tile are always at i - stride, i + stride, i - 1 and i + 1 and the guards
+// read as 0. Boards of any size use as many 64-bit words as they need.
+
+#include <stdint.h>
+
+typedef struct {
+    int stride;          // bits per row: cols + 1 guard column
+    int words;           // 64-bit words per plane
+    uint64_t *ice;       // tile is not water (has fish or a penguin)
+    uint64_t *occupied;  // tile has a penguin on it
+    uint64_t *one_fish;  // tile has exactly 1 fish
+} Bitboard;
+
+// Number of 64-bit words one plane needs for a rows x cols board.
+int bitboard_words(int rows, int cols);
+
+// Point the planes at caller-owned storage of 3 * bitboard_words() words and clear them.
+void bitboard_init(Bitboard *bb, int rows, int cols, uint64_t *storage);
+
+// Bit index of the tile at (r, c).
+static inline int bitboard_index(const Bitboard *bb, int r, int c)
+{
+    return (r + 1) * bb->stride + c;
+}
+
+// Read one bit of a plane.
+static inline int bitboard_test(const uint64_t *plane, int i)
+{
+    return (int)((plane[i >> 6] >> (i & 63)) & 1);
+}
+
+// Set or clear one bit of a plane.
+static inline void bitboard_assign(uint64_t *plane, int i, int on)
+{
+    uint64_t bit = (uint64_t)1 << (i & 63);
+    if (on) plane[i >> 6] |= bit;
+    else plane[i >> 6] &= ~bit;
+}
+
+// Tile at bit i is ice nobody stands on, i.e. a legal move target.
+static inline int bitboard_free(const Bitboard *bb, int i)
+{
+    return bitboard_test(bb->ice, i) & !bitboard_test(bb->occupied, i);
+}
+
+// Update all planes for one tile from its fish count and owner.
+static inline void bitboard_set_tile(Bitboard *bb, int r, int c, int fish, int owner)
+{
+    int i = bitboard_index(bb, r, c);
+    bitboard_assign(bb->ice, i, fish != 0 || owner != 0);
+    bitboard_assign(bb->occupied, i, owner != 0);
+    bitboard_assign(bb->one_fish, i, fish == 1);
+}
+
+// Direction bits of the free neighbours of bit i, in the order up, down, left, right.
+static inline int bitboard_free_neighbours(const Bitboard *bb, int i)
+{
+    return bitboard_free(bb, i - bb->stride)
+         | bitboard_free(bb, i + bb->stride) << 1
+         | bitboard_free(bb, i - 1) << 2
+         | bitboard_free(bb, i + 1) << 3;
+}
+
+// Find the first tile with exactly 1 fish and no penguin. Returns its bit index or -1.
+int bitboard_first_placeable(const Bitboard *bb);
+
+#endif
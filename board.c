@@ -1,159 +1,390 @@
-/* This file contains functions to create, initialize, print, and manage the game board.
-   It also includes functions to check valid moves and find penguins on the board. */
+/* This file contains functions to create, initialize, and manage the game board.
+   It also includes functions to check valid moves and find penguins on the board.
+   The move and placement queries read the bit planes; building with -DBOARD_VERIFY
+   checks every answer against a plain tile-by-tile scan. */
 
-#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "board.h"
+#include "scan.h"
+#include "prof.h"
 
-// ANSI color codes for terminal output
-#define CLR_RESET  "\x1b[0m"
-#define CLR_BLUE   "\x1b[34m"
-#define CLR_RED    "\x1b[31m"
-#define CLR_GREEN  "\x1b[32m"
-#define CLR_YELLOW "\x1b[33m"
+#ifdef BOARD_VERIFY
+#include <assert.h>
+#endif
 
-// Return a color string based on player id
-static const char *player_color(int owner)
+// Zobrist key of one tile value at tile index i; the all-zero tile (water) has key 0.
+// Water is masked out rather than branched on, so bulk loops over random tiles stay fast.
+static uint64_t tile_key(int i, Tile t)
 {
-    switch (owner)
-    {
-        case 1: return CLR_BLUE;
-        case 2: return CLR_RED;
-        case 3: return CLR_GREEN;
-        case 4: return CLR_YELLOW;
-        default: return CLR_RESET;
-    }
+    uint64_t z = ((uint64_t)i << 5 | t) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (z ^ (z >> 31)) & ((uint64_t)0 - (t != 0));
 }
 
-// Create a dynamic 2D board with given rows and columns
-Tile **create_board(int rows, int cols)
+// Create a board with given rows and columns; the header, tiles and bit planes share one allocation
+Board *create_board(int rows, int cols)
 {
+    void *mem;
+
+    if (rows <= 0 || cols <= 0) return NULL;
+
+    mem = malloc(board_bytes(rows, cols));
+    if (!mem) return NULL;
+    return board_layout(mem, rows, cols);
+}
+
+// Lay out an empty board of the given size in memory the caller owns
+Board *board_layout(void *mem, int rows, int cols)
+{
+    Board *board = mem;
+    size_t tile_bytes;
     int i;
-    // Allocate memory for row pointers
-    Tile **board = malloc(rows * sizeof(Tile *));
-    if (!board) return NULL;
 
-    // Allocate memory for each row's columns
-    for (i = 0; i < rows; i++)
+    // keep the planes 8-byte aligned after the tiles
+    tile_bytes = ((size_t)rows * cols * sizeof(Tile) + 7) & ~(size_t)7;
+
+    board->rows = rows;
+    board->cols = cols;
+    board->tiles = (Tile *)(board + 1);
+    memset(board->tiles, 0, (size_t)rows * cols * sizeof(Tile));
+    bitboard_init(&board->bits, rows, cols, (uint64_t *)((char *)board->tiles + tile_bytes));
+    for (i = 0; i <= MAX_PLAYERS; i++)
     {
-        board[i] = malloc(cols * sizeof(Tile));
-        if (!board[i]) return NULL;
+        board->num_penguins[i] = 0;
+        board->mobility[i] = 0;
     }
+    board->placeable = 0;
+    board->hash = 0;
     return board;
 }
 
-// Initialize the board with random fish numbers and no owners
-void init_board(Tile **board, int rows, int cols)
+// Struct, tiles padded to 8 bytes, then the three bit planes
+size_t board_bytes(int rows, int cols)
 {
-    int i, j;
-    for (i = 0; i < rows; i++)
+    size_t tile_bytes = ((size_t)rows * cols * sizeof(Tile) + 7) & ~(size_t)7;
+    return sizeof(Board) + tile_bytes + 3 * (size_t)bitboard_words(rows, cols) * sizeof(uint64_t);
+}
+
+// Number of set bits in a 4-bit direction mask
+static int count_dirs(int mask)
+{
+    static const int bits[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+    return bits[mask];
+}
+
+// Add delta to the mobility of every penguin standing next to plane bit i
+static void adjust_neighbour_mobility(Board *board, int i, int delta)
+{
+    const Bitboard *bb = &board->bits;
+    int around[4];
+    int k;
+
+    around[0] = i - bb->stride;
+    around[1] = i + bb->stride;
+    around[2] = i - 1;
+    around[3] = i + 1;
+    for (k = 0; k < 4; k++)
     {
-        for (j = 0; j < cols; j++)
-        {
-            int r = rand() % 100;
-            if (r < 15)
-                board[i][j].fish = 0;
-            else
-                board[i][j].fish = (rand() % 3) + 1;
+        int t, owner;
+        if (!bitboard_test(bb->occupied, around[k]))
+            continue;   // guard bits are never occupied
 
-            board[i][j].owner = 0;
-        }
+        t = (around[k] / bb->stride - 1) * board->cols + around[k] % bb->stride;
+        owner = tile_owner(board->tiles[t]);
+        board->mobility[owner] += delta;
     }
 }
 
-// Print the board with colors for penguins
-void print_board(Tile **board, int rows, int cols)
+// Take tile index t out of a player's penguin list
+static void remove_penguin(Board *board, int owner, int t)
+{
+    int *list = board->penguins[owner];
+    int n = board->num_penguins[owner], k;
+
+    for (k = 0; k < n && list[k] != t; k++)
+        ;
+    if (k == n)
+        return;
+    for (; k + 1 < n; k++)
+        list[k] = list[k + 1];
+    board->num_penguins[owner] = n - 1;
+}
+
+// Insert tile index t into a player's penguin list, keeping it ascending
+static void insert_penguin(Board *board, int owner, int t)
+{
+    int *list = board->penguins[owner];
+    int k = board->num_penguins[owner];
+
+    if (k == MAX_PENGUINS)
+        return;   // callers never place more; a full list just stops tracking
+    for (; k > 0 && list[k - 1] > t; k--)
+        list[k] = list[k - 1];
+    list[k] = t;
+    board->num_penguins[owner]++;
+}
+
+// Write one tile and update the planes, penguin index, counters and hash that depend on it
+void board_set(Board *board, int r, int c, int fish, int owner)
 {
-    int i, j;
+    int i = r * board->cols + c;
+    int bit = bitboard_index(&board->bits, r, c);
+    int old_owner = tile_owner(board->tiles[i]);
+    int was_free = tile_fish(board->tiles[i]) && !old_owner;
+    int now_free = fish && !owner;
 
-    printf("\n    ");
-    for (j = 0; j < cols; j++)
-        printf("%3d  ", j + 1);
-    printf("\n");
+    PROF_COUNT(PROF_BOARD_SET);
 
-    for (i = 0; i < rows; i++)
+    // a penguin leaving this tile takes its free neighbours out of its player's mobility
+    if (old_owner)
     {
-        printf("%2d |", i + 1);
-        for (j = 0; j < cols; j++)
+        remove_penguin(board, old_owner, i);
+        board->mobility[old_owner] -= count_dirs(bitboard_free_neighbours(&board->bits, bit));
+    }
+    if (owner)
+        insert_penguin(board, owner, i);
+
+    board->placeable += (fish == 1 && !owner) - (board->tiles[i] == make_tile(1, 0));
+    board->hash ^= tile_key(i, board->tiles[i]) ^ tile_key(i, make_tile(fish, owner));
+    board->tiles[i] = make_tile(fish, owner);
+    bitboard_set_tile(&board->bits, r, c, fish, owner);
+
+    // a tile that melts, thaws, or is stepped on or off changes its neighbours' mobility
+    if (now_free != was_free)
+        adjust_neighbour_mobility(board, bit, now_free - was_free);
+    if (owner)
+        board->mobility[owner] += count_dirs(bitboard_free_neighbours(&board->bits, bit));
+}
+
+// Rebuild the planes, penguin index, counters and hash from the tiles
+void board_refresh(Board *board)
+{
+    Bitboard *bb = &board->bits;
+    size_t k, n = (size_t)board->rows * board->cols;
+    uint64_t hash = 0;
+    int placeable = 0;
+    int r, w, p;
+
+    PROF_SCAN(PROF_SCAN_REFRESH, (long)n);
+    for (p = 0; p <= MAX_PLAYERS; p++)
+        board->num_penguins[p] = 0;
+    memset(bb->ice, 0, 3 * (size_t)bb->words * sizeof(uint64_t));
+
+    // planes and the placeable count row by row through the vector kernels
+    for (r = 0; r < board->rows; r++)
+        placeable += scan_pack_tiles(board->tiles + (size_t)r * board->cols, board->cols,
+                                     bb->ice, bb->occupied, bb->one_fish, bitboard_index(bb, r, 0));
+
+    // the hash is branch-free per tile: random fish counts would defeat the branch predictor
+    for (k = 0; k < n; k++)
+        hash ^= tile_key((int)k, board->tiles[k]);
+
+    // penguins are the few set bits of the occupied plane, met in row-major order
+    for (w = 0; w < bb->words; w++)
+    {
+        uint64_t m = bb->occupied[w];
+        while (m)
         {
-            int fish = board[i][j].fish;
-            int owner = board[i][j].owner;
-
-            // Print empty water tile
-            if (fish == 0 && owner == 0)
-            {
-                printf("  -- ");
-            }
-            // Print tile with fish but no owner
-            else if (owner == 0)
-            {
-                printf(" %d(%d)", fish, owner);
-            }
-            // Print tile with fish and a penguin owner in color
-            else
-            {
-                const char *clr = player_color(owner);
-                printf(" %d(%s%d%s)", fish, clr, owner, CLR_RESET);
-            }
+            int bit = w * 64 + __builtin_ctzll(m);
+            int t = (bit / bb->stride - 1) * board->cols + bit % bb->stride;
+            insert_penguin(board, tile_owner(board->tiles[t]), t);
+            m &= m - 1;
+        }
+    }
+    board->placeable = placeable;
+    board->hash = hash;
+
+    // mobility needs the finished planes
+    for (p = 0; p <= MAX_PLAYERS; p++)
+    {
+        int k;
+        board->mobility[p] = 0;
+        for (k = 0; k < board->num_penguins[p]; k++)
+        {
+            int i = board->penguins[p][k];
+            board->mobility[p] += count_dirs(board_move_mask(board, i / board->cols, i % board->cols));
         }
-        printf("\n");
     }
-    printf("\n");
 }
 
-// Check if the placement phase can continue by looking for tiles with 1 fish and no owner
-int can_place(Tile **board, int rows, int cols)
+// Byte lanes of a 64-bit word
+#define LANES_ONE  0x0101010101010101ULL
+#define LANES_HIGH (LANES_ONE * 0x80)
+#define LANES_LOW  (LANES_ONE * 0x7F)
+
+// Tiles for eight random bytes at once, one per byte lane: a byte below 38
+// is water (38 of 256, about 15%), the rest split evenly between 1, 2 and 3
+// fish at 111 and 184. A "byte >= k" test adds 128 - k to the low seven bits
+// so the lane's top bit carries the answer without touching its neighbour
+// (for k = 184 the byte's own top bit must be set and the low bits reach 56).
+// With no branches, random fish counts cost nothing to predict.
+static uint64_t fish_lanes(uint64_t x)
 {
-    int i, j;
-    for (i = 0; i < rows; i++)
-        for (j = 0; j < cols; j++)
-            if (board[i][j].fish == 1 && board[i][j].owner == 0)
-                return 1;
-    return 0;
+    uint64_t high = x & LANES_HIGH, low = x & LANES_LOW;
+    uint64_t ge38 = high | ((low + LANES_ONE * (128 - 38)) & LANES_HIGH);
+    uint64_t ge111 = high | ((low + LANES_ONE * (128 - 111)) & LANES_HIGH);
+    uint64_t ge184 = high & ((low + LANES_ONE * (128 - 56)) & LANES_HIGH);
+    return (ge38 >> 7) + (ge111 >> 7) + (ge184 >> 7);
 }
 
-// Free all dynamically allocated memory of the board properly
-void free_board(Tile **board, int rows)
+// Store eight tiles, lane 0 first, with one 64-bit write on little-endian machines
+static void store_lanes(Tile *p, uint64_t v)
 {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
     int i;
-    if (!board) return;
-    for (i = 0; i < rows; i++)
-        free(board[i]);
-    free(board);
+    for (i = 0; i < 8; i++, v >>= 8)
+        p[i] = (Tile)v;
+#else
+    memcpy(p, &v, 8);
+#endif
 }
 
-// Search the board for a penguin belonging to a player
-int find_penguin(Tile **board, int rows, int cols, int player_id, int *out_r, int *out_c)
+// Initialize the board with random fish numbers and no owners
+void init_board(Board *board, Rng *rng)
 {
-    int r, c;
-    for (r = 0; r < rows; r++)
+    size_t i, n = (size_t)board->rows * board->cols;
+    Tile *tiles = board->tiles;
+    Rng local = *rng;   // tile stores are bytes and could alias the state; a copy stays in registers
+
+    PROF_SCAN(PROF_SCAN_INIT, (long)n);
+
+    // fill the tiles in bulk, eight per draw, then derive everything else once
+    for (i = 0; i + 8 <= n; i += 8)
+        store_lanes(tiles + i, fish_lanes(rng_next(&local)));
+    if (i < n)
     {
-        for (c = 0; c < cols; c++)
-        {
-            if (board[r][c].owner == player_id)
-            {
-                if (out_r) *out_r = r;
-                if (out_c) *out_c = c;
-                return 1;
-            }
-        }
+        uint64_t v = fish_lanes(rng_next(&local));
+        for (; i < n; i++, v >>= 8)
+            tiles[i] = (Tile)v;
     }
-    return 0;
+    *rng = local;
+    board_refresh(board);
+}
+
+#ifdef BOARD_VERIFY
+// Reference scan: first tile with 1 fish and no owner, or -1
+static int scan_first_placeable(const Board *board)
+{
+    int i, n = board->rows * board->cols;
+    for (i = 0; i < n; i++)
+        if (board->tiles[i] == make_tile(1, 0))
+            return i;
+    return -1;
+}
+#endif
+
+#ifdef BOARD_VERIFY
+// Reference count of tiles with 1 fish and no owner
+static int scan_count_placeable(const Board *board)
+{
+    int i, n = board->rows * board->cols, count = 0;
+    for (i = 0; i < n; i++)
+        count += board->tiles[i] == make_tile(1, 0);
+    return count;
+}
+#endif
+
+// Check if the placement phase can continue: read the count of tiles with 1 fish and no owner
+int can_place(const Board *board)
+{
+    PROF_COUNT(PROF_CAN_PLACE);
+#ifdef BOARD_VERIFY
+    assert(board->placeable == scan_count_placeable(board));
+#endif
+    return board->placeable > 0;
+}
+
+// Free the board; header and tiles were allocated together
+void free_board(Board *board)
+{
+    free(board);
+}
+
+// Copy the whole state of src into dst; both boards must have the same size
+void board_copy(Board *dst, const Board *src)
+{
+    PROF_SCAN(PROF_SCAN_COPY, (long)src->rows * src->cols);
+    memcpy(dst->tiles, src->tiles, (size_t)src->rows * src->cols * sizeof(Tile));
+    memcpy(dst->bits.ice, src->bits.ice, 3 * (size_t)src->bits.words * sizeof(uint64_t));
+    memcpy(dst->penguins, src->penguins, sizeof(src->penguins));
+    memcpy(dst->num_penguins, src->num_penguins, sizeof(src->num_penguins));
+    memcpy(dst->mobility, src->mobility, sizeof(src->mobility));
+    dst->placeable = src->placeable;
+    dst->hash = src->hash;
 }
 
-// Check if a tile is empty water (no fish and no owner)
-static int tile_is_empty_water(Tile **board, int r, int c)
+#ifdef BOARD_VERIFY
+// Reference scan: tile index of the first penguin owned by player_id, or -1
+static int scan_find_penguin(const Board *board, int player_id)
 {
-    return (board[r][c].fish == 0 && board[r][c].owner == 0);
+    int i, n = board->rows * board->cols;
+    for (i = 0; i < n; i++)
+        if (tile_owner(board->tiles[i]) == player_id)
+            return i;
+    return -1;
 }
+#endif
+
+// Look up a player's penguin in the position index kept by board_set
+int find_penguin(const Board *board, int player_id, int *out_r, int *out_c)
+{
+    int i;
+    PROF_COUNT(PROF_FIND_PENGUIN);
+    if (player_id < 1 || player_id > MAX_PLAYERS)
+        return 0;
+
+    i = board->num_penguins[player_id] > 0 ? board->penguins[player_id][0] : -1;
+#ifdef BOARD_VERIFY
+    assert(i == scan_find_penguin(board, player_id));
+#endif
+    if (i < 0)
+        return 0;
+
+    if (out_r) *out_r = i / board->cols;
+    if (out_c) *out_c = i % board->cols;
+    return 1;
+}
+
+#ifdef BOARD_VERIFY
+// Reference check: a tile can be entered if it is not water and nobody stands on it
+static int scan_tile_is_free(const Board *board, int r, int c)
+{
+    Tile t = board->tiles[r * board->cols + c];
+    return tile_fish(t) != 0 && tile_owner(t) == 0;
+}
+
+// Reference scan of the 4 neighbours, returning DIR_* bits
+static int scan_move_mask(const Board *board, int r, int c)
+{
+    int mask = 0;
+    if (r > 0 && scan_tile_is_free(board, r - 1, c)) mask |= DIR_UP;
+    if (r + 1 < board->rows && scan_tile_is_free(board, r + 1, c)) mask |= DIR_DOWN;
+    if (c > 0 && scan_tile_is_free(board, r, c - 1)) mask |= DIR_LEFT;
+    if (c + 1 < board->cols && scan_tile_is_free(board, r, c + 1)) mask |= DIR_RIGHT;
+    return mask;
+}
+
+// Reference count of the free neighbours of every penguin a player has
+static int scan_mobility(const Board *board, int player_id)
+{
+    int i, n = board->rows * board->cols, count = 0;
+    for (i = 0; i < n; i++)
+        if (tile_owner(board->tiles[i]) == player_id)
+            count += count_dirs(scan_move_mask(board, i / board->cols, i % board->cols));
+    return count;
+}
+#endif
 
 // Check if a move is valid: inside bounds, adjacent, not empty water, and unoccupied
-int is_valid_move(Tile **board, int rows, int cols, int player_id, int from_r, int from_c, int to_r, int to_c)
+int is_valid_move(const Board *board, int player_id, int from_r, int from_c, int to_r, int to_c)
 {
     int dr = to_r - from_r;
     int dc = to_c - from_c;
 
-    if (to_r < 0 || to_r >= rows || to_c < 0 || to_c >= cols)
+    PROF_COUNT(PROF_IS_VALID_MOVE);
+    if (to_r < 0 || to_r >= board->rows || to_c < 0 || to_c >= board->cols)
         return 0;
 
     
@@ -161,87 +392,190 @@ int is_valid_move(Tile **board, int rows, int cols, int player_id, int from_r, i
         return 0;
 
     
-    if (tile_is_empty_water(board, to_r, to_c))
-        return 0;
-
-    
-    if (board[to_r][to_c].owner != 0)
+    // destination must be ice (not empty water) with no penguin on it
+    if (!bitboard_free(&board->bits, bitboard_index(&board->bits, to_r, to_c)))
+    {
+#ifdef BOARD_VERIFY
+        assert(!scan_tile_is_free(board, to_r, to_c));
+#endif
         return 0;
+    }
+#ifdef BOARD_VERIFY
+    assert(scan_tile_is_free(board, to_r, to_c));
+#endif
 
     (void)player_id; 
     return 1;
 }
 
-// Check if the player has at least one valid move available
-int player_can_move(Tile **board, int rows, int cols, int player_id)
+// Check if the player has at least one valid move available, from the mobility counter
+int player_can_move(const Board *board, int player_id)
 {
-    int r, c;
-    if (!find_penguin(board, rows, cols, player_id, &r, &c))
+    PROF_COUNT(PROF_PLAYER_CAN_MOVE);
+    if (player_id < 1 || player_id > MAX_PLAYERS || board->num_penguins[player_id] == 0)
         return 0;
 
-    if (is_valid_move(board, rows, cols, player_id, r, c, r - 1, c)) return 1;
-    if (is_valid_move(board, rows, cols, player_id, r, c, r + 1, c)) return 1;
-    if (is_valid_move(board, rows, cols, player_id, r, c, r, c - 1)) return 1;
-    if (is_valid_move(board, rows, cols, player_id, r, c, r, c + 1)) return 1;
-
-    return 0;
+#ifdef BOARD_VERIFY
+    assert(board->mobility[player_id] == scan_mobility(board, player_id));
+#endif
+    return board->mobility[player_id] > 0;
 }
 
-// Find the first tile suitable for penguin placement (used by AI)
-int find_first_placement(Tile **board, int rows, int cols, int *out_r, int *out_c)
+// List the legal moves of every penguin of a player: penguins in row-major
+// order, each in direction order up, down, left, right. The direction masks
+// come straight from the planes, so a penguin costs one plane read per side.
+int board_gen_moves(const Board *board, int player_id, Move *out)
 {
-    int r, c;
-    for (r = 0; r < rows; r++)
+    int offset[4];
+    int k, count, n = 0;
+
+    PROF_COUNT(PROF_GEN_MOVES);
+    if (player_id < 1 || player_id > MAX_PLAYERS)
+        return 0;
+
+    offset[0] = -board->cols;
+    offset[1] = board->cols;
+    offset[2] = -1;
+    offset[3] = 1;
+
+    count = board->num_penguins[player_id];
+    for (k = 0; k < count; k++)
     {
-        for (c = 0; c < cols; c++)
+        int from = board->penguins[player_id][k];
+        int mask = board_move_mask(board, from / board->cols, from % board->cols);
+#ifdef BOARD_VERIFY
+        assert(mask == scan_move_mask(board, from / board->cols, from % board->cols));
+#endif
+        while (mask)
         {
-            if (board[r][c].fish == 1 && board[r][c].owner == 0)
-            {
-                if (out_r) *out_r = r;
-                if (out_c) *out_c = c;
-                return 1;
-            }
+            int d = __builtin_ctz(mask);
+            out[n].from = from;
+            out[n].to = from + offset[d];
+            out[n].dir = d;
+            out[n].fish = tile_fish(board->tiles[out[n].to]);
+            n++;
+            mask &= mask - 1;
         }
     }
-    return 0;
+    return n;
 }
 
-// Simple AI heuristic to find the best adjacent move with the most fish
-int find_best_adjacent_move(Tile **board, int rows, int cols, int player_id, int *to_r, int *to_c)
+// Move a penguin between two tile indices and remember what the two tiles held
+int make_move(Board *board, int player_id, int from, int to, MoveDelta *delta)
 {
-    int pr, pc;
-    int best_r = -1, best_c = -1;
-    int best_fish = -1;
-
-    if (!find_penguin(board, rows, cols, player_id, &pr, &pc))
-        return 0;
+    int cols = board->cols;
+    int fish = tile_fish(board->tiles[to]);
 
-    if (is_valid_move(board, rows, cols, player_id, pr, pc, pr - 1, pc))
+    PROF_COUNT(PROF_MAKE_MOVE);
+    if (delta)
     {
-        best_r = pr - 1;
-        best_c = pc;
-        best_fish = board[best_r][best_c].fish;
+        delta->from = from;
+        delta->to = to;
+        delta->from_tile = board->tiles[from];
+        delta->to_tile = board->tiles[to];
     }
-    if (is_valid_move(board, rows, cols, player_id, pr, pc, pr + 1, pc))
-    {
-        int f = board[pr + 1][pc].fish;
-        if (f > best_fish) { best_r = pr + 1; best_c = pc; best_fish = f; }
-    }
-    if (is_valid_move(board, rows, cols, player_id, pr, pc, pr, pc - 1))
+
+    // source first, so a player with every penguin out never lists one too many
+    board_set(board, from / cols, from % cols, 0, 0);
+    board_set(board, to / cols, to % cols, 0, player_id);
+    return fish;
+}
+
+// Put both tiles back; the destination goes first, for the same reason as in make_move
+void unmake_move(Board *board, const MoveDelta *delta)
+{
+    int cols = board->cols;
+    PROF_COUNT(PROF_UNMAKE_MOVE);
+    board_set(board, delta->to / cols, delta->to % cols,
+              tile_fish(delta->to_tile), tile_owner(delta->to_tile));
+    board_set(board, delta->from / cols, delta->from % cols,
+              tile_fish(delta->from_tile), tile_owner(delta->from_tile));
+}
+
+// Check if a player's penguin has at least one free neighbour, from the mobility counter
+int board_has_moves(const Board *board, int player_id)
+{
+    PROF_COUNT(PROF_HAS_MOVES);
+    if (player_id < 1 || player_id > MAX_PLAYERS)
+        return 0;
+#ifdef BOARD_VERIFY
+    assert(board->mobility[player_id] == scan_mobility(board, player_id));
+#endif
+    return board->mobility[player_id] > 0;
+}
+
+// Walk the turn order from side until someone can move
+int board_next_mover(const Board *board, int num_players, int side)
+{
+    int k;
+    for (k = 0; k < num_players; k++)
     {
-        int f = board[pr][pc - 1].fish;
-        if (f > best_fish) { best_r = pr; best_c = pc - 1; best_fish = f; }
+        int p = (side - 1 + k) % num_players + 1;
+        if (board_has_moves(board, p))
+            return p;
     }
-    if (is_valid_move(board, rows, cols, player_id, pr, pc, pr, pc + 1))
+    return 0;
+}
+
+// Swap every penguin's tile back to a free 1-fish tile in the hash, one tile key pair each
+uint64_t board_unplaced_key(const Board *board)
+{
+    uint64_t key = board->hash;
+    int owner, k;
+
+    for (owner = 1; owner <= MAX_PLAYERS; owner++)
     {
-        int f = board[pr][pc + 1].fish;
-        if (f > best_fish) { best_r = pr; best_c = pc + 1; best_fish = f; }
+        for (k = 0; k < board->num_penguins[owner]; k++)
+        {
+            int t = board->penguins[owner][k];
+            Tile tile = board->tiles[t];
+            key ^= tile_key(t, tile) ^ tile_key(t, make_tile(1, 0));
+        }
     }
+    return key;
+}
+
+// Find the first tile suitable for penguin placement (used by AI)
+int find_first_placement(const Board *board, int *out_r, int *out_c)
+{
+    int i, r, c;
 
-    if (best_r == -1)
+    // the counter answers "none left" without touching the planes
+    PROF_COUNT(PROF_FIND_FIRST_PLACEMENT);
+    i = board->placeable > 0 ? bitboard_first_placeable(&board->bits) : -1;
+    if (board->placeable > 0)
+        PROF_SCAN(PROF_SCAN_PLACEMENT, i < 0 ? (long)board->bits.words * 64 : i + 1L);
+    r = i / board->bits.stride - 1;
+    c = i % board->bits.stride;
+
+#ifdef BOARD_VERIFY
+    assert(i < 0 ? scan_first_placeable(board) < 0
+                 : scan_first_placeable(board) == r * board->cols + c);
+#endif
+    if (i < 0)
         return 0;
 
-    if (to_r) *to_r = best_r;
-    if (to_c) *to_c = best_c;
+    if (out_r) *out_r = r;
+    if (out_c) *out_c = c;
+    return 1;
+}
+
+// Simple AI heuristic to find the adjacent move with the most fish over all of a player's penguins
+int find_best_adjacent_move(const Board *board, int player_id, Move *move)
+{
+    Move moves[MAX_MOVES];
+    int n, i, best = -1;
+
+    PROF_COUNT(PROF_FIND_BEST_MOVE);
+    n = board_gen_moves(board, player_id, moves);
+
+    // ties go to the first penguin, then to up, down, left, right
+    for (i = 0; i < n; i++)
+        if (best < 0 || moves[i].fish > moves[best].fish)
+            best = i;
+
+    if (best < 0)
+        return 0;
+    if (move) *move = moves[best];
     return 1;
-}
\ No newline at end of file
+}
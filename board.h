@@ -3,41 +3,183 @@
 
 // This header file defines the board structure and functions related to the board.
 
+#include <stddef.h>
+#include "bitboard.h"
+#include "rng.h"
+
+// Highest player id a tile can be owned by.
+#define MAX_PLAYERS 4
+
+// Most penguins one player may have on the board.
+#define MAX_PENGUINS 4
+
+// Most rows or columns a game board may have.
+#define BOARD_MAX_SIDE 4096
+
+// One cell on the board, packed into a single byte:
+// bits 0-1 hold the number of fish (0-3), bits 2-4 the owner (0 = none, 1-4 = player id).
+typedef unsigned char Tile;
+
+// Direction bits returned by board_move_mask, in the AI's tie-break order.
+#define DIR_UP    1
+#define DIR_DOWN  2
+#define DIR_LEFT  4
+#define DIR_RIGHT 8
+
+// This struct represents the whole board. The tiles and the bit planes live
+// in the same allocation as the struct itself.
 typedef struct {
-    // This struct represents one cell on the board.
-    int fish;   // Number of fish on this tile.
-    int owner;  // Which player owns this tile, -1 if none.
-} Tile;
+    int rows;      // Number of rows.
+    int cols;      // Number of columns.
+    Tile *tiles;   // rows * cols packed tiles, row-major.
+    Bitboard bits; // Ice / occupied / 1-fish planes, kept in sync by board_set.
+    int penguins[MAX_PLAYERS + 1][MAX_PENGUINS]; // Tile indices (r * cols + c) of each player's penguins, ascending.
+    int num_penguins[MAX_PLAYERS + 1];            // Penguins each player has on the board.
+    int mobility[MAX_PLAYERS + 1];   // Free neighbours summed over each player's penguins.
+    int placeable; // Tiles with exactly 1 fish and no owner, kept in sync by board_set.
+    uint64_t hash; // Zobrist key of all tiles (fish and owners), kept in sync by board_set.
+} Board;
+
+// Read the fish count of a packed tile.
+static inline int tile_fish(Tile t)
+{
+    return t & 0x3;
+}
+
+// Read the owner of a packed tile.
+static inline int tile_owner(Tile t)
+{
+    return (t >> 2) & 0x7;
+}
 
-// Create a new board with given rows and columns, allocating memory dynamically.
-Tile **create_board(int rows, int cols);
+// Pack fish and owner into one tile.
+static inline Tile make_tile(int fish, int owner)
+{
+    return (Tile)((fish & 0x3) | ((owner & 0x7) << 2));
+}
 
-// Initialize the board by setting fish counts on each tile.
-void init_board(Tile **board, int rows, int cols);
+// Number of fish on the tile at (r, c).
+static inline int board_fish(const Board *board, int r, int c)
+{
+    return tile_fish(board->tiles[r * board->cols + c]);
+}
+
+// Owner of the tile at (r, c), 0 if none.
+static inline int board_owner(const Board *board, int r, int c)
+{
+    return tile_owner(board->tiles[r * board->cols + c]);
+}
+
+// Overwrite the tile at (r, c) with the given fish and owner.
+// Keeps the bit planes, penguin positions, counters and hash in sync with the tile in O(1).
+void board_set(Board *board, int r, int c, int fish, int owner);
+
+// Direction bits (DIR_*) of the legal 1-step moves from (r, c).
+static inline int board_move_mask(const Board *board, int r, int c)
+{
+    return bitboard_free_neighbours(&board->bits, bitboard_index(&board->bits, r, c));
+}
+
+// Direction (0-3, as in Move.dir) of the 1-step move between two tile indices, -1 if they are not neighbours.
+static inline int board_move_dir(const Board *board, int from, int to)
+{
+    int cols = board->cols;
+    if (to == from - cols) return 0;
+    if (to == from + cols) return 1;
+    if (to == from - 1 && from % cols != 0) return 2;
+    if (to == from + 1 && to % cols != 0) return 3;
+    return -1;
+}
+
+// Tile index a 1-step move in direction dir (0-3) onto tile index to started from.
+static inline int board_move_source(const Board *board, int to, int dir)
+{
+    static const int dr[4] = { 1, -1, 0, 0 };
+    static const int dc[4] = { 0, 0, 1, -1 };
+    return to + dr[dir & 3] * board->cols + dc[dir & 3];
+}
+
+// One legal penguin move, as produced by board_gen_moves.
+typedef struct {
+    int from;   // tile index the penguin leaves
+    int to;     // tile index it moves onto
+    int dir;    // 0-3: up, down, left, right (the bit number in DIR_*)
+    int fish;   // fish on the destination
+} Move;
 
-// Print the current state of the board to the terminal.
-void print_board(Tile **board, int rows, int cols);
+// Most moves one player can have: four directions for each penguin.
+#define MAX_MOVES (4 * MAX_PENGUINS)
+
+// What one move changed on the board, enough for unmake_move to take it back.
+typedef struct {
+    int from;         // tile index the penguin left
+    int to;           // tile index it moved onto
+    Tile from_tile;   // both tiles as they were before the move
+    Tile to_tile;
+} MoveDelta;
+
+// Create a new board with given rows and columns using a single allocation.
+Board *create_board(int rows, int cols);
+
+// Bytes create_board allocates for a board of this size.
+size_t board_bytes(int rows, int cols);
+
+// Lay out an empty board in board_bytes(rows, cols) bytes of 8-byte aligned
+// memory owned by the caller (who must not pass it to free_board). Returns mem.
+Board *board_layout(void *mem, int rows, int cols);
+
+// Initialize the board by setting fish counts on each tile, drawing from rng.
+void init_board(Board *board, Rng *rng);
+
+// Recompute the planes, penguin index, counters and hash after board->tiles was written directly.
+void board_refresh(Board *board);
 
 // Check if the placement phase can continue (if there are places to put penguins).
-int can_place(Tile **board, int rows, int cols);
+int can_place(const Board *board);
 
 // Free the memory allocated for the board.
-void free_board(Tile **board, int rows);
+void free_board(Board *board);
 
-// Find the position of a player's penguin on the board.
+// Copy tiles, planes, penguin positions and hash between two boards of the same size.
+void board_copy(Board *dst, const Board *src);
+
+// Find the position of a player's first penguin (in row-major order) on the board.
 // Returns 1 if found, and sets out_r and out_c to the position.
-int find_penguin(Tile **board, int rows, int cols, int player_id, int *out_r, int *out_c);
+int find_penguin(const Board *board, int player_id, int *out_r, int *out_c);
 
-// Check if the player has any valid moves left.
-int player_can_move(Tile **board, int rows, int cols, int player_id);
+// Check if any of the player's penguins has a valid move left.
+int player_can_move(const Board *board, int player_id);
 
 // Check if a move from (from_r, from_c) to (to_r, to_c) is valid according to game rules.
-int is_valid_move(Tile **board, int rows, int cols, int player_id, int from_r, int from_c, int to_r, int to_c);
+int is_valid_move(const Board *board, int player_id, int from_r, int from_c, int to_r, int to_c);
+
+// Write the legal moves of all of a player's penguins into out (room for MAX_MOVES),
+// penguin by penguin in row-major order, then up, down, left, right. Returns how many there are.
+int board_gen_moves(const Board *board, int player_id, Move *out);
+
+// Move player_id's penguin on tile index from to tile index to; the tile it leaves melts.
+// Records the change in *delta (if not NULL) and returns the fish collected.
+int make_move(Board *board, int player_id, int from, int to, MoveDelta *delta);
+
+// Take back a move recorded by make_move. Moves must be taken back newest first.
+void unmake_move(Board *board, const MoveDelta *delta);
+
+// Check if a player has any legal move, without listing them.
+int board_has_moves(const Board *board, int player_id);
+
+// First player in turn order from `side` onwards (ids 1..num_players, wrapping) who can move, 0 if nobody can.
+int board_next_mover(const Board *board, int num_players, int side);
+
+// Zobrist key of the board as it was before its penguins were placed, with
+// every penguin's tile counted as a free 1-fish tile: placing a penguin
+// leaves it unchanged, any move changes it.
+uint64_t board_unplaced_key(const Board *board);
 
 // Used by AI to find the first place to put a penguin.
-int find_first_placement(Tile **board, int rows, int cols, int *out_r, int *out_c);
+int find_first_placement(const Board *board, int *out_r, int *out_c);
 
-// Used by AI to find the best adjacent move for a player.
-int find_best_adjacent_move(Tile **board, int rows, int cols, int player_id, int *to_r, int *to_c);
+// Used by AI to find the best adjacent move of any of a player's penguins.
+// Returns 1 and stores it in *move, 0 if the player cannot move.
+int find_best_adjacent_move(const Board *board, int player_id, Move *move);
 
-#endif
\ No newline at end of file
+#endif
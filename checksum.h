@@ -0,0 +1,13 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+// This header declares the 64-bit checksum used by the binary file formats.
+// It is the XXH64 algorithm, so files can also be checked with any xxHash tool.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Checksum len bytes of data; a different seed gives an unrelated checksum.
+uint64_t checksum64(const void *data, size_t len, uint64_t seed);
+
+#endif
@@ -0,0 +1,586 @@
+/* This file implements the training dataset writer and reader declared in dataset.h.
+   The writer packs each position into a fixed-size record as the move is
+   made, keeps the game's records in one growing buffer until the game ends,
+   then writes them (or compresses them block by block) with single fwrite
+   calls. The reader maps the whole file and hands out records in place;
+   compressed blocks are checked and decoded one at a time into a buffer. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dataset.h"
+#include "checksum.h"
+
+struct Dataset {
+    FILE *out;
+    DatasetInfo shape;
+    int collecting;           // 1 between dataset_begin and dataset_finish
+    int skip;                 // the game in progress does not fit the file
+    unsigned char *game;      // this game's records
+    size_t count, cap;
+    unsigned char *block;     // records waiting for a compressed block
+    size_t pending;
+    unsigned char *packed;    // block header and encoded payload
+    uint64_t records, bytes;  // written so far
+};
+
+struct DatasetReader {
+    const unsigned char *map;
+    size_t size;
+    DatasetInfo info;
+    uint64_t next;            // plain files: next record
+    size_t at;                // compressed files: offset of the next block
+    unsigned char *block;     // compressed files: the decoded block
+    size_t block_count, block_next;
+};
+
+// Store a 16-bit value little-endian
+static void put_u16(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+// Store a 32-bit value little-endian
+static void put_u32(unsigned char *p, uint32_t v)
+{
+    put_u16(p, v);
+    put_u16(p + 2, v >> 16);
+}
+
+// Store a 64-bit value little-endian
+static void put_u64(unsigned char *p, uint64_t v)
+{
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+// Read a little-endian 16-bit value
+static uint32_t get_u16(const unsigned char *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8;
+}
+
+// Read a little-endian 32-bit value
+static uint32_t get_u32(const unsigned char *p)
+{
+    return get_u16(p) | get_u16(p + 2) << 16;
+}
+
+// Read a little-endian 64-bit value
+static uint64_t get_u64(const unsigned char *p)
+{
+    return (uint64_t)get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+
+// Bytes per seat: score and margin, 4 bytes each (2 each in version 1 files)
+static size_t seat_bytes(int version)
+{
+    return version < 2 ? 4 : 8;
+}
+
+// Offsets inside a record
+static size_t seats_at(void) { return 8; }
+static size_t penguins_at(const DatasetInfo *s)
+{
+    return seats_at() + seat_bytes(s->version) * (size_t)s->players;
+}
+static size_t fish_at(const DatasetInfo *s)
+{
+    return penguins_at(s) + 4 * (size_t)s->players * s->penguins;
+}
+
+// Move, seats and penguin slots, then 2 bits of fish per tile, padded to 4 bytes
+static size_t record_bytes(int version, int rows, int cols, int players, int penguins)
+{
+    size_t fish_bytes = ((size_t)rows * cols + 3) / 4;
+    return (8 + seat_bytes(version) * (size_t)players + 4 * (size_t)players * penguins + fish_bytes + 3) &
+           ~(size_t)3;
+}
+
+// Record size of the version written now
+size_t dataset_record_bytes(int rows, int cols, int players, int penguins)
+{
+    return record_bytes(DATASET_VERSION, rows, cols, players, penguins);
+}
+
+// Fill in a shape and its record size
+static void set_shape(DatasetInfo *s, int version, int rows, int cols, int players, int penguins, int flags)
+{
+    s->version = version;
+    s->rows = rows;
+    s->cols = cols;
+    s->players = players;
+    s->penguins = penguins;
+    s->flags = flags;
+    s->record_bytes = record_bytes(version, rows, cols, players, penguins);
+    s->records = 0;
+}
+
+// Write the 48-byte header
+int dataset_write_header(FILE *out, int rows, int cols, int players, int penguins, int flags)
+{
+    unsigned char h[DATASET_HEADER_BYTES];
+
+    memset(h, 0, sizeof(h));
+    memcpy(h, DATASET_MAGIC, 8);
+    put_u32(h + 8, DATASET_VERSION);
+    put_u32(h + 12, DATASET_HEADER_BYTES);
+    put_u32(h + 16, (uint32_t)rows);
+    put_u32(h + 20, (uint32_t)cols);
+    put_u32(h + 24, (uint32_t)players);
+    put_u32(h + 28, (uint32_t)penguins);
+    put_u32(h + 32, (uint32_t)dataset_record_bytes(rows, cols, players, penguins));
+    put_u32(h + 36, (uint32_t)flags);
+    put_u32(h + 40, DATASET_BLOCK_RECORDS);
+    return fwrite(h, 1, sizeof(h), out) == sizeof(h);
+}
+
+// Create a writer; compressed files get their block buffers up front
+Dataset *dataset_create(FILE *out, int rows, int cols, int players, int penguins, int flags)
+{
+    Dataset *dataset = calloc(1, sizeof(Dataset));
+    size_t block_bytes;
+
+    if (!dataset) return NULL;
+    dataset->out = out;
+    set_shape(&dataset->shape, DATASET_VERSION, rows, cols, players, penguins, flags);
+    if (flags & DATASET_COMPRESSED)
+    {
+        // an encoded byte takes at most two, for an isolated zero
+        block_bytes = DATASET_BLOCK_RECORDS * dataset->shape.record_bytes;
+        dataset->block = malloc(block_bytes);
+        dataset->packed = malloc(DATASET_BLOCK_HEADER + 2 * block_bytes);
+        if (!dataset->block || !dataset->packed)
+        {
+            dataset_free(dataset);
+            return NULL;
+        }
+    }
+    return dataset;
+}
+
+// Free the writer and its buffers
+void dataset_free(Dataset *dataset)
+{
+    if (!dataset) return;
+    free(dataset->game);
+    free(dataset->block);
+    free(dataset->packed);
+    free(dataset);
+}
+
+// Start a game; it is skipped unless it has the file's board size, seats and room for its penguins
+void dataset_begin(Dataset *dataset, const Game *game)
+{
+    const DatasetInfo *s = &dataset->shape;
+    int i;
+
+    dataset->collecting = 1;
+    dataset->count = 0;
+    dataset->skip = game->board->rows != s->rows || game->board->cols != s->cols ||
+                    game->num_players != s->players;
+    for (i = 0; i < game->num_players && !dataset->skip; i++)
+    {
+        int id = game->players[i].id;
+        if (id < 1 || id > MAX_PLAYERS ||
+            game->players[i].left + game->board->num_penguins[id] > s->penguins)
+            dataset->skip = 1;
+    }
+}
+
+// Pack the position before the move into a new record
+void dataset_move(Dataset *dataset, const Game *game, int idx, int from, int to)
+{
+    const DatasetInfo *s = &dataset->shape;
+    const Board *board = game->board;
+    size_t rb = s->record_bytes, tiles = (size_t)board->rows * board->cols, t;
+    unsigned char *rec, *p, *fish;
+    int i, k;
+
+    if (!dataset->collecting || dataset->skip)
+        return;
+    if (dataset->count == dataset->cap)
+    {
+        size_t cap = dataset->cap ? dataset->cap * 2 : 64;
+        unsigned char *grown = realloc(dataset->game, cap * rb);
+        if (!grown)
+        {
+            dataset->skip = 1;
+            return;
+        }
+        dataset->game = grown;
+        dataset->cap = cap;
+    }
+
+    rec = dataset->game + dataset->count++ * rb;
+    memset(rec, 0, rb);
+    put_u32(rec, (uint32_t)from);
+    rec[4] = (unsigned char)idx;
+    rec[5] = (unsigned char)board_move_dir(board, from, to);
+
+    // scores now; the margins are filled in when the game ends
+    for (i = 0; i < s->players; i++)
+        put_u32(rec + seats_at() + 8 * i, (uint32_t)game->players[i].score);
+
+    p = rec + penguins_at(s);
+    for (i = 0; i < s->players; i++)
+    {
+        int id = game->players[i].id;
+        for (k = 0; k < s->penguins; k++, p += 4)
+            put_u32(p, k < board->num_penguins[id] ? (uint32_t)board->penguins[id][k] : DATASET_NONE);
+    }
+
+    fish = rec + fish_at(s);
+    for (t = 0; t < tiles; t++)
+        fish[t >> 2] |= (unsigned char)(tile_fish(board->tiles[t]) << ((t & 3) * 2));
+}
+
+// Drop the latest record
+void dataset_unmake(Dataset *dataset)
+{
+    if (dataset->collecting && !dataset->skip && dataset->count > 0)
+        dataset->count--;
+}
+
+// XOR each record with the one before, then write zero runs as (0, length - 1)
+static size_t encode_block(const unsigned char *recs, size_t len, size_t rb, unsigned char *out)
+{
+    size_t i, n = 0, run = 0;
+
+    for (i = 0; i < len; i++)
+    {
+        unsigned char b = recs[i] ^ (i >= rb ? recs[i - rb] : 0);
+        if (b == 0 && run < 256)
+        {
+            run++;
+            continue;
+        }
+        if (run)
+        {
+            out[n++] = 0;
+            out[n++] = (unsigned char)(run - 1);
+            run = 0;
+        }
+        if (b == 0)
+            run = 1;
+        else
+            out[n++] = b;
+    }
+    if (run)
+    {
+        out[n++] = 0;
+        out[n++] = (unsigned char)(run - 1);
+    }
+    return n;
+}
+
+// Undo encode_block; returns 0 unless the payload fills out exactly
+static int decode_block(const unsigned char *in, size_t n, unsigned char *out, size_t len, size_t rb)
+{
+    size_t i = 0, o = 0;
+
+    while (i < n)
+    {
+        if (in[i] != 0)
+        {
+            if (o >= len) return 0;
+            out[o++] = in[i++];
+            continue;
+        }
+        if (i + 1 >= n || o + in[i + 1] + 1 > len)
+            return 0;
+        memset(out + o, 0, (size_t)in[i + 1] + 1);
+        o += (size_t)in[i + 1] + 1;
+        i += 2;
+    }
+    if (o != len)
+        return 0;
+    for (o = rb; o < len; o++)
+        out[o] ^= out[o - rb];
+    return 1;
+}
+
+// Encode the pending records and write them as one block
+int dataset_flush(Dataset *dataset)
+{
+    size_t rb = dataset->shape.record_bytes, n;
+
+    if (!(dataset->shape.flags & DATASET_COMPRESSED) || dataset->pending == 0)
+        return 1;
+
+    n = encode_block(dataset->block, dataset->pending * rb, rb, dataset->packed + DATASET_BLOCK_HEADER);
+    put_u32(dataset->packed, (uint32_t)dataset->pending);
+    put_u32(dataset->packed + 4, (uint32_t)n);
+    put_u64(dataset->packed + 8, checksum64(dataset->packed + DATASET_BLOCK_HEADER, n, 0));
+    dataset->records += dataset->pending;
+    dataset->bytes += DATASET_BLOCK_HEADER + n;
+    dataset->pending = 0;
+    return fwrite(dataset->packed, 1, DATASET_BLOCK_HEADER + n, dataset->out) == DATASET_BLOCK_HEADER + n;
+}
+
+// Fill in every seat's final margin, then write the game's records
+int dataset_finish(Dataset *dataset, const Game *game)
+{
+    const DatasetInfo *s = &dataset->shape;
+    size_t rb = s->record_bytes, r, done;
+    int margin[MAX_PLAYERS];
+    int i, j;
+
+    if (!dataset->collecting)
+        return 1;
+    dataset->collecting = 0;
+    if (dataset->skip || dataset->count == 0)
+        return 1;
+
+    for (i = 0; i < s->players; i++)
+    {
+        int best = 0, first = 1;
+        for (j = 0; j < s->players; j++)
+        {
+            if (j != i && (first || game->players[j].score > best))
+            {
+                best = game->players[j].score;
+                first = 0;
+            }
+        }
+        margin[i] = game->players[i].score - best;
+    }
+    for (r = 0; r < dataset->count; r++)
+        for (i = 0; i < s->players; i++)
+            put_u32(dataset->game + r * rb + seats_at() + 8 * i + 4, (uint32_t)margin[i]);
+
+    if (!(s->flags & DATASET_COMPRESSED))
+    {
+        dataset->records += dataset->count;
+        dataset->bytes += dataset->count * rb;
+        return fwrite(dataset->game, rb, dataset->count, dataset->out) == dataset->count;
+    }
+
+    // fill the pending block, writing it out each time it is full
+    for (done = 0; done < dataset->count; )
+    {
+        size_t take = DATASET_BLOCK_RECORDS - dataset->pending;
+        if (take > dataset->count - done)
+            take = dataset->count - done;
+        memcpy(dataset->block + dataset->pending * rb, dataset->game + done * rb, take * rb);
+        dataset->pending += take;
+        done += take;
+        if (dataset->pending == DATASET_BLOCK_RECORDS && !dataset_flush(dataset))
+            return 0;
+    }
+    return 1;
+}
+
+uint64_t dataset_records_written(const Dataset *dataset)
+{
+    return dataset->records;
+}
+
+uint64_t dataset_bytes_written(const Dataset *dataset)
+{
+    return dataset->bytes;
+}
+
+// Check the header and count the records, hopping over block headers
+static int read_layout(DatasetReader *reader)
+{
+    const unsigned char *h = reader->map;
+    DatasetInfo *info = &reader->info;
+    uint32_t version;
+    size_t at;
+
+    if (reader->size < DATASET_HEADER_BYTES || memcmp(h, DATASET_MAGIC, 8) != 0)
+        return 0;
+    version = get_u32(h + 8);
+    if (version < 1 || version > DATASET_VERSION || get_u32(h + 12) != DATASET_HEADER_BYTES)
+        return 0;
+    set_shape(info, (int)version, (int)get_u32(h + 16), (int)get_u32(h + 20), (int)get_u32(h + 24),
+              (int)get_u32(h + 28), (int)get_u32(h + 36));
+    if (info->rows < 1 || info->rows > BOARD_MAX_SIDE || info->cols < 1 || info->cols > BOARD_MAX_SIDE ||
+        info->players < 1 || info->players > MAX_PLAYERS || info->penguins < 1 ||
+        info->penguins > MAX_PENGUINS || (info->flags & ~DATASET_COMPRESSED) != 0 ||
+        get_u32(h + 32) != info->record_bytes || get_u32(h + 40) != DATASET_BLOCK_RECORDS)
+        return 0;
+
+    if (!(info->flags & DATASET_COMPRESSED))
+    {
+        if ((reader->size - DATASET_HEADER_BYTES) % info->record_bytes != 0)
+            return 0;
+        info->records = (reader->size - DATASET_HEADER_BYTES) / info->record_bytes;
+        return 1;
+    }
+
+    for (at = DATASET_HEADER_BYTES; at < reader->size; )
+    {
+        uint32_t count, len;
+        if (reader->size - at < DATASET_BLOCK_HEADER)
+            return 0;
+        count = get_u32(reader->map + at);
+        len = get_u32(reader->map + at + 4);
+        if (count < 1 || count > DATASET_BLOCK_RECORDS || len > reader->size - at - DATASET_BLOCK_HEADER)
+            return 0;
+        info->records += count;
+        at += DATASET_BLOCK_HEADER + len;
+    }
+    return 1;
+}
+
+// Map the file read-only and check its layout
+DatasetReader *dataset_open(const char *filename)
+{
+    DatasetReader *reader;
+    struct stat st;
+    void *map;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+    if (fstat(fd, &st) != 0 || st.st_size < DATASET_HEADER_BYTES)
+    {
+        close(fd);
+        return NULL;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    // records are read front to back, so let the kernel read ahead
+    posix_madvise(map, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+
+    reader = calloc(1, sizeof(DatasetReader));
+    if (!reader)
+    {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    reader->map = map;
+    reader->size = (size_t)st.st_size;
+    if (!read_layout(reader))
+    {
+        dataset_close(reader);
+        return NULL;
+    }
+    if (reader->info.flags & DATASET_COMPRESSED)
+    {
+        reader->block = malloc(DATASET_BLOCK_RECORDS * reader->info.record_bytes);
+        if (!reader->block)
+        {
+            dataset_close(reader);
+            return NULL;
+        }
+    }
+    dataset_rewind(reader);
+    return reader;
+}
+
+// Unmap the file and free the block buffer
+void dataset_close(DatasetReader *reader)
+{
+    if (!reader) return;
+    munmap((void *)reader->map, reader->size);
+    free(reader->block);
+    free(reader);
+}
+
+const DatasetInfo *dataset_info(const DatasetReader *reader)
+{
+    return &reader->info;
+}
+
+// Start again from the first record
+void dataset_rewind(DatasetReader *reader)
+{
+    reader->next = 0;
+    reader->at = DATASET_HEADER_BYTES;
+    reader->block_count = 0;
+    reader->block_next = 0;
+}
+
+// Hand out the next record, decoding the next block when the current one is used up
+const unsigned char *dataset_next(DatasetReader *reader)
+{
+    const DatasetInfo *info = &reader->info;
+    const unsigned char *h;
+    uint32_t count, len;
+
+    if (!(info->flags & DATASET_COMPRESSED))
+    {
+        if (reader->next >= info->records)
+            return NULL;
+        return reader->map + DATASET_HEADER_BYTES + reader->next++ * info->record_bytes;
+    }
+
+    if (reader->block_next == reader->block_count)
+    {
+        if (reader->at >= reader->size)
+            return NULL;
+        h = reader->map + reader->at;
+        count = get_u32(h);
+        len = get_u32(h + 4);
+        reader->at += DATASET_BLOCK_HEADER + len;
+        if (get_u64(h + 8) != checksum64(h + DATASET_BLOCK_HEADER, len, 0) ||
+            !decode_block(h + DATASET_BLOCK_HEADER, len, reader->block, count * info->record_bytes,
+                          info->record_bytes))
+        {
+            // stop at the damaged block
+            reader->at = reader->size;
+            reader->block_count = reader->block_next = 0;
+            return NULL;
+        }
+        reader->block_count = count;
+        reader->block_next = 0;
+    }
+    return reader->block + reader->block_next++ * info->record_bytes;
+}
+
+// Plain files only: the record straight from the mapping
+const unsigned char *dataset_record(const DatasetReader *reader, uint64_t i)
+{
+    if ((reader->info.flags & DATASET_COMPRESSED) || i >= reader->info.records)
+        return NULL;
+    return reader->map + DATASET_HEADER_BYTES + i * reader->info.record_bytes;
+}
+
+// Unpack the fixed fields; the fish stay in the record
+void dataset_decode(const DatasetReader *reader, const unsigned char *rec, DatasetSample *out)
+{
+    const DatasetInfo *info = &reader->info;
+    const int step[4] = { -info->cols, info->cols, -1, 1 };
+    const unsigned char *p;
+    int i, k;
+
+    out->from = (int)get_u32(rec);
+    out->side = rec[4];
+    out->dir = rec[5] & 3;
+    out->to = out->from + step[out->dir];
+    for (i = 0; i < MAX_PLAYERS; i++)
+    {
+        const unsigned char *seat = rec + seats_at() + seat_bytes(info->version) * i;
+        out->score[i] = out->margin[i] = 0;
+        if (i < info->players && info->version < 2)
+        {
+            out->score[i] = (int)get_u16(seat);
+            out->margin[i] = (int16_t)get_u16(seat + 2);
+        }
+        else if (i < info->players)
+        {
+            out->score[i] = (int)get_u32(seat);
+            out->margin[i] = (int32_t)get_u32(seat + 4);
+        }
+        for (k = 0; k < MAX_PENGUINS; k++)
+            out->penguins[i][k] = -1;
+    }
+    p = rec + penguins_at(info);
+    for (i = 0; i < info->players; i++)
+        for (k = 0; k < info->penguins; k++, p += 4)
+            if (get_u32(p) != DATASET_NONE)
+                out->penguins[i][k] = (int)get_u32(p);
+    out->fish = rec + fish_at(info);
+}
@@ -0,0 +1,147 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+// This header declares the training dataset writer and reader.
+// A dataset is a stream of movement-phase positions, each with the move that
+// was played from it and how the game ended for every seat, meant for fitting
+// evaluation functions offline. Every record of a file has the same size, set
+// by the board size, players and penguins per player in the file header.
+// Samples of a game are held back until the game ends (the margins are only
+// known then) and appended with one fwrite, so several threads' writers can
+// share one file the way replay recorders do.
+//
+// File layout, all integers little-endian:
+//   header (48 bytes): magic "PENGDSET", version, header size, rows, cols,
+//                      players, penguins per player, record size, flags,
+//                      records per block, reserved
+//   records, back to back (plain files), or
+//   blocks (DATASET_COMPRESSED): record count, payload size (4 bytes each),
+//                      XXH64 of the payload, then the payload
+// A block payload is its records, each XORed with the one before it (the
+// first with zeros), with every run of zero bytes written as a zero and the
+// run length - 1. Consecutive positions of a game differ in a few bytes, so
+// blocks come out several times smaller than the records.
+//
+// Record layout (record size bytes, padded to 4):
+//   0   4   tile index the penguin moved from
+//   4   1   index of the player to move
+//   5   1   direction moved (0-3, as in Move.dir)
+//   6   2   reserved (0)
+//   8   8   per seat: score before the move (4 bytes), final margin (4 bytes,
+//           signed: final score minus the best other final score)
+//   ..  4   per seat, per penguin: tile index, 0xFFFFFFFF for none
+//   ..      fish, 2 bits per tile, 4 tiles per byte, row-major
+// Version 1 files, still read, have 4 bytes per seat: 2 for the score and 2
+// for the margin, which wrap past 65535 and +-32767 on large boards.
+
+#include <stdio.h>
+#include <stdint.h>
+#include "game.h"
+
+#define DATASET_MAGIC        "PENGDSET"
+#define DATASET_VERSION      2
+#define DATASET_HEADER_BYTES 48
+#define DATASET_BLOCK_HEADER 16
+
+// Header flags.
+#define DATASET_COMPRESSED 1   // records are stored in compressed blocks
+
+// Records per compressed block.
+#define DATASET_BLOCK_RECORDS 4096
+
+// Tile index of an empty penguin slot.
+#define DATASET_NONE 0xFFFFFFFFu
+
+// Shape of the records in one file.
+typedef struct {
+    int rows, cols;
+    int players;           // seats per game
+    int penguins;          // penguin slots per seat
+    int flags;             // DATASET_COMPRESSED or 0
+    int version;           // file format version
+    size_t record_bytes;
+    uint64_t records;      // records in the file (reader only)
+} DatasetInfo;
+
+// One record, decoded.
+typedef struct {
+    int side;                                  // index of the player to move
+    int from, to;                              // the move played, tile indices
+    int dir;                                   // 0-3: up, down, left, right
+    int score[MAX_PLAYERS];                    // scores before the move
+    int margin[MAX_PLAYERS];                   // final score minus best other final score
+    int penguins[MAX_PLAYERS][MAX_PENGUINS];   // tile indices, -1 for none
+    const unsigned char *fish;                 // 2 bits per tile, inside the record
+} DatasetSample;
+
+// Fish on a tile of a decoded sample.
+static inline int dataset_fish(const DatasetSample *s, int tile)
+{
+    return (s->fish[tile >> 2] >> ((tile & 3) * 2)) & 3;
+}
+
+// Bytes of one record of this shape, in the version written now.
+size_t dataset_record_bytes(int rows, int cols, int players, int penguins);
+
+// Write a file header for records of this shape. Returns 0 on a write error.
+int dataset_write_header(FILE *out, int rows, int cols, int players, int penguins, int flags);
+
+typedef struct Dataset Dataset;
+
+// Create a writer appending records of this shape to out (whose header is
+// already written, opened for binary writing and owned by the caller).
+// Returns NULL on failure.
+Dataset *dataset_create(FILE *out, int rows, int cols, int players, int penguins, int flags);
+
+// Free the writer; samples not yet written are dropped (see dataset_flush).
+void dataset_free(Dataset *dataset);
+
+// Start collecting a game. A game of another shape than the file is skipped.
+void dataset_begin(Dataset *dataset, const Game *game);
+
+// Collect the position before player idx moves a penguin from one tile to another.
+void dataset_move(Dataset *dataset, const Game *game, int idx, int from, int to);
+
+// Forget the latest sample (undo).
+void dataset_unmake(Dataset *dataset);
+
+// Fill in the final margins and write the game's samples (in compressed files,
+// into the pending block, written whenever it fills). Returns 0 on a write error.
+int dataset_finish(Dataset *dataset, const Game *game);
+
+// Write the pending block of a compressed file. Returns 0 on a write error.
+int dataset_flush(Dataset *dataset);
+
+// Records and bytes this writer has written so far.
+uint64_t dataset_records_written(const Dataset *dataset);
+uint64_t dataset_bytes_written(const Dataset *dataset);
+
+typedef struct DatasetReader DatasetReader;
+
+// Memory-map a dataset file, check its header and count the records (hopping
+// over the block headers of a compressed file). Returns NULL if it cannot be
+// read or its layout is damaged.
+DatasetReader *dataset_open(const char *filename);
+
+// Unmap the file.
+void dataset_close(DatasetReader *reader);
+
+// Shape and record count of the file.
+const DatasetInfo *dataset_info(const DatasetReader *reader);
+
+// Next record in file order, NULL after the last or at a block whose checksum
+// fails. The pointer stays valid until the next call (compressed blocks are
+// decoded into one buffer).
+const unsigned char *dataset_next(DatasetReader *reader);
+
+// Go back to the first record.
+void dataset_rewind(DatasetReader *reader);
+
+// Record i of a plain (uncompressed) file, straight from the mapping; NULL
+// if i is out of range or the file is compressed.
+const unsigned char *dataset_record(const DatasetReader *reader, uint64_t i);
+
+// Decode a record of this file.
+void dataset_decode(const DatasetReader *reader, const unsigned char *rec, DatasetSample *out);
+
+#endif
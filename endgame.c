@@ -0,0 +1,443 @@
+/* This file implements the endgame solver declared in endgame.h.
+   A region is numbered into at most 64 slots: its free tiles plus the tile
+   the penguin stood on when the numbering was made. A state is the slot the
+   penguin is on and the bit set of tiles still left; before a state is looked
+   up, the set is cut down to the tiles the penguin can still reach, so states
+   that differ only in tiles it has walled off share one memo entry. Each
+   penguin keeps its numbering while its region only shrinks, which is what
+   every move does, so the memo filled on one move answers most of the next.
+   A player whose penguins are each alone scores the sum of their paths, and
+   since the regions are apart, any penguin may take the next step. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "endgame.h"
+
+#ifdef BOARD_VERIFY
+#include <assert.h>
+#endif
+
+// One player's numbering of its region
+typedef struct {
+    int rows, cols;                  // board the numbering was made on
+    int n;                           // slots in use
+    int tile[64];                    // board tile index of each slot
+    int fish[64];
+    uint64_t adj[64];                // slots next to each slot
+    uint64_t fish1, fish2, fish3;    // slots holding 1, 2 or 3 fish
+    uint32_t gen;                    // memo generation, 0 = no numbering yet
+} Region;
+
+// One memoized state
+typedef struct {
+    uint64_t left;     // tiles left (reachable ones only)
+    uint32_t gen;      // generation of the numbering it belongs to
+    unsigned char pos; // slot the penguin is on
+    short value;       // most fish still to collect
+} MemoEntry;
+
+struct Endgame {
+    MemoEntry *memo;
+    Region regions[MAX_PLAYERS + 1][MAX_PENGUINS];   // one numbering per penguin
+    uint32_t next_gen;
+    long nodes;        // states visited by the current solve
+    int given_up;      // the current solve ran past the node limit
+    EndgameStats total;
+};
+
+// Slots (2^bits) of the set collect_region marks visited tiles in
+#define SEEN_BITS 7
+
+// Largest region a -DBOARD_VERIFY build checks against a plain search of every path
+#define VERIFY_TILES 16
+
+// Neighbours in the AI's tie-break order: up, down, left, right
+static const int dr[4] = { -1, 1, 0, 0 };
+static const int dc[4] = { 0, 0, -1, 1 };
+
+// Create a solver with an empty memo
+Endgame *endgame_create(void)
+{
+    Endgame *endgame = calloc(1, sizeof(Endgame));
+    if (!endgame) return NULL;
+
+    endgame->memo = calloc((size_t)1 << ENDGAME_MEMO_BITS, sizeof(MemoEntry));
+    if (!endgame->memo)
+    {
+        free(endgame);
+        return NULL;
+    }
+    return endgame;
+}
+
+// Free the solver and its memo
+void endgame_free(Endgame *endgame)
+{
+    if (!endgame) return;
+    free(endgame->memo);
+    free(endgame);
+}
+
+// Check if a tile is free ice: fish on it and no penguin
+static int is_free(const Board *board, int t)
+{
+    Tile tile = board->tiles[t];
+    return tile_fish(tile) > 0 && tile_owner(tile) == 0;
+}
+
+// Position of tile t in list, -1 if it is not there
+static int find_tile(const int *list, int n, int t)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        if (list[i] == t) return i;
+    return -1;
+}
+
+// Add tile t to a small open-addressing set (room for twice ENDGAME_MAX_TILES).
+// Returns 0 if it was already there.
+static int mark_tile(int *set, int t)
+{
+    unsigned h = ((unsigned)t * 2654435761u) >> (32 - SEEN_BITS);
+    while (set[h] >= 0)
+    {
+        if (set[h] == t)
+            return 0;
+        h = (h + 1) & ((1u << SEEN_BITS) - 1);
+    }
+    set[h] = t;
+    return 1;
+}
+
+// Flood fill the free tiles the penguin on tile index from can reach into
+// tiles (room for ENDGAME_MAX_TILES). Returns how many, or -1 if any other
+// penguin, the player's own included, stands next to one of them or there are
+// too many. The fill walks the guarded bit planes, so no neighbour needs a
+// bounds check.
+static int collect_region(const Board *board, int from, int *tiles)
+{
+    const Bitboard *bb = &board->bits;
+    int seen[1 << SEEN_BITS];
+    int step[4];
+    int n = 0, head, d, at;
+
+    at = bitboard_index(bb, from / board->cols, from % board->cols);
+    step[0] = -bb->stride; step[1] = bb->stride; step[2] = -1; step[3] = 1;
+    memset(seen, -1, sizeof(seen));
+
+    // the penguin's own tile seeds the fill but is not part of the region; a
+    // penguin next to it does not matter, since the tile melts on the first move
+    for (head = -1; head < n; head++)
+    {
+        int i = head < 0 ? at : tiles[head];
+
+        for (d = 0; d < 4; d++)
+        {
+            int ni = i + step[d];
+            if (bitboard_free(bb, ni))
+            {
+                if (!mark_tile(seen, ni))
+                    continue;
+                if (n == ENDGAME_MAX_TILES)
+                    return -1;
+                tiles[n++] = ni;
+            }
+            else if (head >= 0 && ni != at && bitboard_test(bb->occupied, ni))
+            {
+                return -1;   // another penguin can step into the region
+            }
+        }
+    }
+
+    // hand back board tile indices
+    for (head = 0; head < n; head++)
+        tiles[head] = (tiles[head] / bb->stride - 1) * board->cols + tiles[head] % bb->stride;
+    return n;
+}
+
+// Check whether each of the player's penguins is alone in a small region
+int endgame_region(const Board *board, int player_id)
+{
+    int tiles[ENDGAME_MAX_TILES];
+    int k, n, total = 0;
+
+    if (player_id < 1 || player_id > MAX_PLAYERS || board->num_penguins[player_id] == 0)
+        return -1;
+    for (k = 0; k < board->num_penguins[player_id]; k++)
+    {
+        n = collect_region(board, board->penguins[player_id][k], tiles);
+        if (n < 0)
+            return -1;
+        total += n;
+    }
+    return total;
+}
+
+// Number the region's tiles and the penguin's tile afresh
+static void number_region(Endgame *endgame, Region *reg, const Board *board,
+                          const int *tiles, int n, int from)
+{
+    int i, d;
+
+    reg->rows = board->rows;
+    reg->cols = board->cols;
+    reg->n = n + 1;
+    memcpy(reg->tile, tiles, n * sizeof(int));
+    reg->tile[n] = from;
+    reg->fish1 = reg->fish2 = reg->fish3 = 0;
+
+    for (i = 0; i < reg->n; i++)
+    {
+        int t = reg->tile[i];
+        int r = t / reg->cols, c = t % reg->cols;
+
+        reg->fish[i] = i < n ? tile_fish(board->tiles[t]) : 0;
+        if (reg->fish[i] == 1) reg->fish1 |= (uint64_t)1 << i;
+        if (reg->fish[i] == 2) reg->fish2 |= (uint64_t)1 << i;
+        if (reg->fish[i] == 3) reg->fish3 |= (uint64_t)1 << i;
+
+        reg->adj[i] = 0;
+        for (d = 0; d < 4; d++)
+        {
+            int nr = r + dr[d], nc = c + dc[d], j;
+            if (nr < 0 || nr >= reg->rows || nc < 0 || nc >= reg->cols)
+                continue;
+            j = find_tile(reg->tile, reg->n, nr * reg->cols + nc);
+            if (j >= 0)
+                reg->adj[i] |= (uint64_t)1 << j;
+        }
+    }
+
+    // a new generation makes every memo entry of the old numbering miss
+    if (++endgame->next_gen == 0)
+        endgame->next_gen = 1;
+    reg->gen = endgame->next_gen;
+}
+
+// Express the region in the player's current numbering: the tiles left as a
+// bit set and the penguin's slot. Returns 0 if the numbering does not cover it.
+static int map_region(const Region *reg, const Board *board, const int *tiles, int n, int from,
+                      uint64_t *left, int *pos)
+{
+    int i;
+
+    if (!reg->gen || reg->rows != board->rows || reg->cols != board->cols)
+        return 0;
+    *pos = find_tile(reg->tile, reg->n, from);
+    if (*pos < 0)
+        return 0;
+
+    *left = 0;
+    for (i = 0; i < n; i++)
+    {
+        int j = find_tile(reg->tile, reg->n, tiles[i]);
+        if (j < 0 || reg->fish[j] != tile_fish(board->tiles[tiles[i]]))
+            return 0;
+        *left |= (uint64_t)1 << j;
+    }
+    return 1;
+}
+
+// Tiles of left the penguin on slot pos can still walk to
+static uint64_t reachable(const Region *reg, int pos, uint64_t left)
+{
+    uint64_t seen = reg->adj[pos] & left, grow = seen;
+
+    while (grow)
+    {
+        uint64_t next = 0, m;
+        for (m = grow; m; m &= m - 1)
+            next |= reg->adj[__builtin_ctzll(m)];
+        grow = next & left & ~seen;
+        seen |= grow;
+    }
+    return seen;
+}
+
+// Fish on a set of slots
+static int fish_sum(const Region *reg, uint64_t set)
+{
+    return __builtin_popcountll(set & reg->fish1) + 2 * __builtin_popcountll(set & reg->fish2) +
+           3 * __builtin_popcountll(set & reg->fish3);
+}
+
+// Most fish the penguin on slot pos can still collect from left
+static int best_path(Endgame *endgame, const Region *reg, int pos, uint64_t left)
+{
+    MemoEntry *e;
+    uint64_t m;
+    int best = 0, bound;
+
+    left = reachable(reg, pos, left);
+    if (!left)
+        return 0;
+
+    endgame->total.memo_probes++;
+    e = &endgame->memo[((left * 0x9E3779B97F4A7C15ULL) ^ ((uint64_t)pos * 0xBF58476D1CE4E5B9ULL))
+                       >> (64 - ENDGAME_MEMO_BITS)];
+    if (e->gen == reg->gen && e->left == left && e->pos == pos)
+    {
+        endgame->total.memo_hits++;
+        return e->value;
+    }
+
+    if (++endgame->nodes > ENDGAME_NODE_LIMIT)
+    {
+        endgame->given_up = 1;
+        return 0;
+    }
+
+    // no path collects more than every reachable fish, so stop on reaching that
+    bound = fish_sum(reg, left);
+    for (m = reg->adj[pos] & left; m && best < bound; m &= m - 1)
+    {
+        int j = __builtin_ctzll(m);
+        int v = reg->fish[j] + best_path(endgame, reg, j, left & ~((uint64_t)1 << j));
+        if (endgame->given_up)
+            return 0;
+        if (v > best)
+            best = v;
+    }
+
+    e->left = left;
+    e->gen = reg->gen;
+    e->pos = (unsigned char)pos;
+    e->value = (short)best;
+    return best;
+}
+
+#ifdef BOARD_VERIFY
+// Reference for the solver: the most fish a walk from tile index at can collect
+// over the unused tiles of the list, trying every path with no memo or pruning
+static int verify_path(const Board *board, const int *tiles, int n, char *used, int at)
+{
+    int d, best = 0;
+
+    for (d = 0; d < 4; d++)
+    {
+        int nr = at / board->cols + dr[d], nc = at % board->cols + dc[d], j, v;
+        if (nr < 0 || nr >= board->rows || nc < 0 || nc >= board->cols)
+            continue;
+        j = find_tile(tiles, n, nr * board->cols + nc);
+        if (j < 0 || used[j])
+            continue;
+        used[j] = 1;
+        v = tile_fish(board->tiles[tiles[j]]) + verify_path(board, tiles, n, used, tiles[j]);
+        used[j] = 0;
+        if (v > best)
+            best = v;
+    }
+    return best;
+}
+
+// Check a solved region against the reference: the value, and that the move reaches it
+static void verify_solve(const Board *board, const int *tiles, int n, int from, const Move *move, int best)
+{
+    char used[ENDGAME_MAX_TILES] = {0};
+
+    if (n > VERIFY_TILES)
+        return;
+    assert(verify_path(board, tiles, n, used, from) == best);
+    if (move->from >= 0)
+    {
+        used[find_tile(tiles, n, move->to)] = 1;
+        assert(move->fish + verify_path(board, tiles, n, used, move->to) == best);
+    }
+}
+#endif
+
+// Solve the region of the player's penguin in list place slot, on tile index
+// from. Returns the fish it can still collect and its first move in *move
+// (move->from = -1 if it is stuck), or -1 if the region is not the penguin's
+// alone or the search gave up.
+static int solve_penguin(Endgame *endgame, Region *regions, const Board *board, int slot, int from, Move *move)
+{
+    int tiles[ENDGAME_MAX_TILES];
+    const Region *reg = NULL;
+    uint64_t left;
+    int n, k, pos, d, best = -1;
+
+    move->from = -1;
+    n = collect_region(board, from, tiles);
+    if (n < 0)
+        return -1;
+
+    // keep a numbering (and its memo entries) while its region only shrinks;
+    // penguins can swap list places, so every numbering of the player is tried
+    for (k = 0; k < MAX_PENGUINS && !reg; k++)
+        if (map_region(&regions[k], board, tiles, n, from, &left, &pos))
+            reg = &regions[k];
+    if (!reg)
+    {
+        number_region(endgame, &regions[slot], board, tiles, n, from);
+        map_region(&regions[slot], board, tiles, n, from, &left, &pos);
+        reg = &regions[slot];
+    }
+
+    // try the moves in tie-break order so equal paths resolve like the other AIs
+    for (d = 0; d < 4; d++)
+    {
+        int nr = from / board->cols + dr[d], nc = from % board->cols + dc[d], j, v;
+        if (nr < 0 || nr >= board->rows || nc < 0 || nc >= board->cols || !is_free(board, nr * board->cols + nc))
+            continue;
+        j = find_tile(reg->tile, reg->n, nr * board->cols + nc);
+        v = reg->fish[j] + best_path(endgame, reg, j, left & ~((uint64_t)1 << j));
+        if (endgame->given_up)
+            return -1;
+        if (v > best)
+        {
+            best = v;
+            move->from = from;
+            move->to = nr * board->cols + nc;
+            move->dir = d;
+            move->fish = reg->fish[j];
+        }
+    }
+    if (best < 0)
+        best = 0;
+#ifdef BOARD_VERIFY
+    verify_solve(board, tiles, n, from, move, best);
+#endif
+    return best;
+}
+
+// Solve every penguin of the player; the first one that can move takes the next step
+int endgame_solve(Endgame *endgame, const Board *board, int player_id, Move *move, int *fish)
+{
+    int k, total = 0, v = 0;
+    Move first;
+
+    if (player_id < 1 || player_id > MAX_PLAYERS || board->num_penguins[player_id] == 0)
+        return 0;
+    first.from = -1;
+
+    endgame->nodes = 0;
+    endgame->given_up = 0;
+    for (k = 0; k < board->num_penguins[player_id] && v >= 0; k++)
+    {
+        Move m;
+        v = solve_penguin(endgame, endgame->regions[player_id], board, k, board->penguins[player_id][k], &m);
+        total += v;
+        if (first.from < 0 && m.from >= 0)
+            first = m;
+    }
+
+    endgame->total.nodes += endgame->nodes;
+    if (v < 0)
+    {
+        if (endgame->given_up)
+            endgame->total.given_up++;
+        return 0;
+    }
+    endgame->total.solves++;
+
+    if (move) *move = first;
+    if (fish) *fish = total;
+    return 1;
+}
+
+// Totals since the solver was created
+const EndgameStats *endgame_total_stats(const Endgame *endgame)
+{
+    return &endgame->total;
+}
@@ -0,0 +1,58 @@
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+// This header declares the endgame solver.
+// Tiles melt as penguins leave them, so the ice soon breaks into regions no
+// penguin can cross. A penguin whose region no other penguin can reach plays
+// a one-player game: its remaining score is the heaviest path it can walk
+// through the region, whatever the others do. A player whose penguins are
+// each alone like that scores the sum of their paths. The solver finds that path
+// exactly by depth-first search over (tile, tiles left) states, memoized in
+// a table that carries over from one move to the next. Regions only ever
+// shrink, so the region check is a flood fill from the penguin that stops as
+// soon as it meets another penguin or outgrows the solver.
+
+#include "board.h"
+
+// Largest region (free tiles) the solver takes. The states fit 64-bit tile sets,
+// but past about 40 tiles an exact solve costs more than a search per move.
+#define ENDGAME_MAX_TILES 40
+
+// Memo entries (2^bits) and the most states one solve may visit before giving up.
+#define ENDGAME_MEMO_BITS 16
+#define ENDGAME_NODE_LIMIT 2000000
+
+// Counters summed over every solve since the solver was created.
+typedef struct {
+    long solves;      // regions solved exactly
+    long given_up;    // solves that ran past the node limit
+    long nodes;       // states visited
+    long memo_probes; // memo lookups
+    long memo_hits;   // lookups that found the state
+} EndgameStats;
+
+typedef struct Endgame Endgame;
+
+// Create a solver. Returns NULL on failure.
+Endgame *endgame_create(void);
+
+// Free the solver and its memo table.
+void endgame_free(Endgame *endgame);
+
+// Check whether each of player_id's penguins is alone in a region of at most
+// ENDGAME_MAX_TILES free tiles. Returns the number of free tiles they can
+// still reach (0 when all are stuck), or -1 if the player has no penguin,
+// another penguin (the player's own included) can reach one of the regions,
+// or a region is too large.
+int endgame_region(const Board *board, int player_id);
+
+// Solve player_id's regions. Returns 1 with the fish the player can still
+// collect in *fish and the next move in *move (move->from = -1 if every
+// penguin is stuck); 0 if a penguin is not alone, a region is too large or
+// the search ran past ENDGAME_NODE_LIMIT.
+int endgame_solve(Endgame *endgame, const Board *board, int player_id, Move *move, int *fish);
+
+// Statistics summed over every solve since the solver was created.
+const EndgameStats *endgame_total_stats(const Endgame *endgame);
+
+#endif
@@ -1,15 +1,51 @@
-/* This file controls the game flow including placement and movement phases.  
-   It also supports saving and loading the game state from a file. */
+/* This file controls the game flow including placement and movement phases.
+   It also supports saving and loading the game state from a file.
+   The same phases drive interactive and headless games; with game->quiet set
+   nothing is printed and only AI players take turns. */
+
+#define _POSIX_C_SOURCE 200809L
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "game.h"
-
-void clear_screen(void)
+#include "checksum.h"
+#include "journal.h"
+#include "replay.h"
+#include "dataset.h"
+#include "ponder.h"
+#include "prof.h"
+
+// Binary save format (V2). All integers are little-endian.
+//   header (64 bytes): magic, version, header size, rows, cols, players, mode,
+//                      turn index, active mask, penguin count, payload size, checksum
+//   players: id, is_ai, left, score (4 bytes each) and a 32-byte name
+//   rng:     board seed and stream (8 bytes each), from version 3 on
+//   fish:    2 bits per tile, 4 tiles per byte, row-major
+//   penguins: tile index and owner (4 bytes each) of every owned tile
+// The checksum is XXH64 of everything after the header, seeded with XXH64 of
+// the header bytes before the checksum field.
+#define SAVE_MAGIC_V2       "PENGSAV2"
+#define SAVE_VERSION        3
+#define SAVE_RNG_BYTES      16
+#define SAVE_HEADER_BYTES   64
+#define SAVE_CHECKSUM_AT    56
+#define SAVE_PLAYER_BYTES   48
+#define SAVE_PENGUIN_BYTES  8
+
+// Print a game message unless the game runs headless
+static void game_log(const Game *game, const char *fmt, ...)
 {
-    printf("\033[2J");   // Clear entire screen
-    printf("\033[H");    // Move cursor to top-left
+    va_list ap;
+    if (game->quiet) return;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
 }
 
 // Check if all penguins are placed (left == 0 for all players)
@@ -21,67 +57,256 @@ static int all_penguins_placed(Player *players, int num_players)
     return 1;
 }
 
-// Save the current game state to a file
-int save_game(const char *filename, Tile **board, int rows, int cols, Player *players, int num_players, int mode, int turn_index, int *active_flags)
+// Set up a game around an existing board and players, with everyone active
+void init_game(Game *game, Board *board, Player *players, int num_players, int mode)
 {
-    FILE *fp;
-    int i, r, c;
+    int i;
+    game->board = board;
+    game->players = players;
+    game->num_players = num_players;
+    game->mode = mode;
+    game->turn_index = 0;
+    for (i = 0; i < MAX_PLAYERS; i++)
+        game->active_flags[i] = i < num_players;
+    game->quiet = 0;
+    game->turns = 0;
+    game->search = NULL;
+    game->mcts = NULL;
+    game->endgame = NULL;
+    game->placement = NULL;
+    game->ponder = NULL;
+    game->fast_forwarded = 0;
+    game->view = NULL;
+    game->journal = NULL;
+    game->replay = NULL;
+    game->dataset = NULL;
+    game->seed = 0;
+    game->stream = 0;
+    game->history.head = 0;
+    game->history.count = 0;
+    game->history.redo = 0;
+}
 
-    // open file for writing
-    fp = fopen(filename, "w");
-    if (!fp) return 0;
+// Store a 32-bit value little-endian
+static void put_u32(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
 
-    // write header and version
-    fprintf(fp, "PENGUINS_SAVE_V1\n");
+// Store a 64-bit value little-endian
+static void put_u64(unsigned char *p, uint64_t v)
+{
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
 
-    // write board size and number of players, mode, turn index
-    fprintf(fp, "%d %d\n", rows, cols);
-    fprintf(fp, "%d %d %d\n", num_players, mode, turn_index);
+// Read a little-endian 32-bit value
+static uint32_t get_u32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
 
-    // write active flags for players
+// Read a little-endian 64-bit value
+static uint64_t get_u64(const unsigned char *p)
+{
+    return (uint64_t)get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+
+// Number of penguins on the board, counted 64 tiles at a time from the occupied plane
+static uint32_t count_penguins(const Board *board)
+{
+    uint32_t count = 0;
+    int w;
+    for (w = 0; w < board->bits.words; w++)
+    {
+        uint64_t x = board->bits.occupied[w];
+        while (x)
+        {
+            x &= x - 1;
+            count++;
+        }
+    }
+    return count;
+}
+
+// Check the loaded players: ids are exactly 1..num_players, engines and mode are known ones
+static int players_valid(const Player *players, int num_players, int mode)
+{
+    int seen[MAX_PLAYERS + 1] = {0};
+    int i;
+
+    if (mode != MODE_PVP && mode != MODE_PVAI)
+        return 0;
     for (i = 0; i < num_players; i++)
     {
-        fprintf(fp, "%d", active_flags ? active_flags[i] : 1);
-        if (i + 1 < num_players) fprintf(fp, " ");
+        int id = players[i].id;
+        if (id < 1 || id > num_players || seen[id]++ ||
+            players[i].is_ai < AI_NONE || players[i].is_ai > AI_MCTS)
+            return 0;
     }
-    fprintf(fp, "\n");
+    return 1;
+}
 
-    // write each player's data
+// Check a loaded position against the penguin limit: nobody may own more than
+// MAX_PENGUINS tiles or have more penguins to place than the limit leaves room for,
+// and no tile may belong to a player outside the game. Needs players_valid first.
+static int penguins_fit(const Board *board, const Player *players, int num_players)
+{
+    int owned[MAX_PLAYERS + 1] = {0};
+    long i, tiles = (long)board->rows * board->cols;
+
+    for (i = 0; i < tiles; i++)
+    {
+        int owner = tile_owner(board->tiles[i]);
+        if (owner > num_players || (owner && ++owned[owner] > MAX_PENGUINS))
+            return 0;
+    }
     for (i = 0; i < num_players; i++)
     {
-        fprintf(fp, "%d %d %d %d %s\n",
-                players[i].id,
-                players[i].is_ai,
-                players[i].left,
-                players[i].score,
-                players[i].name);
+        if (players[i].left < 0 || players[i].left > MAX_PENGUINS ||
+            owned[players[i].id] + players[i].left > MAX_PENGUINS)
+            return 0;
     }
+    return 1;
+}
 
-    // write all board tiles with fish and owner info
-    for (r = 0; r < rows; r++)
+// Write all bytes to a file descriptor
+static int write_all(int fd, const unsigned char *p, size_t len)
+{
+    while (len > 0)
     {
-        for (c = 0; c < cols; c++)
+        ssize_t n = write(fd, p, len);
+        if (n <= 0) return 0;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+// Bytes of the V2 image of the game
+size_t save_game_image_size(const Game *game)
+{
+    const Board *board = game->board;
+    size_t fish_bytes = ((size_t)board->rows * board->cols + 3) / 4;
+    return SAVE_HEADER_BYTES + (size_t)game->num_players * SAVE_PLAYER_BYTES + SAVE_RNG_BYTES +
+           fish_bytes + (size_t)count_penguins(board) * SAVE_PENGUIN_BYTES;
+}
+
+// Build the V2 image of the game in a new buffer
+unsigned char *save_game_image(const Game *game, size_t *out_size)
+{
+    size_t size = save_game_image_size(game);
+    unsigned char *buf = malloc(size);
+
+    if (!buf) return NULL;
+    save_game_image_to(game, buf, size);
+    *out_size = size;
+    return buf;
+}
+
+// Write the V2 image into buf (size bytes, from save_game_image_size): players,
+// packed fish, penguin list, then the header that checksums them
+void save_game_image_to(const Game *game, unsigned char *buf, size_t size)
+{
+    const Board *board = game->board;
+    size_t tiles = (size_t)board->rows * board->cols;
+    size_t fish_bytes = (tiles + 3) / 4;
+    uint32_t penguins = count_penguins(board);
+    unsigned char *p, *fish, *pen;
+    uint32_t active = 0;
+    size_t i;
+
+    memset(buf, 0, size);
+    PROF_SCAN(PROF_SCAN_SAVE, (long)tiles);
+
+    // players
+    p = buf + SAVE_HEADER_BYTES;
+    for (i = 0; i < (size_t)game->num_players; i++, p += SAVE_PLAYER_BYTES)
+    {
+        const Player *pl = &game->players[i];
+        put_u32(p, (uint32_t)pl->id);
+        put_u32(p + 4, (uint32_t)pl->is_ai);
+        put_u32(p + 8, (uint32_t)pl->left);
+        put_u32(p + 12, (uint32_t)pl->score);
+        memcpy(p + 16, pl->name, sizeof(pl->name));
+        if (game->active_flags[i]) active |= 1u << i;
+    }
+
+    // where the board came from, so it can be generated again
+    put_u64(p, game->seed);
+    put_u64(p + 8, game->stream);
+    p += SAVE_RNG_BYTES;
+
+    // fish, 4 tiles per byte; owned tiles go to the penguin list as they are met
+    fish = p;
+    pen = fish + fish_bytes;
+    for (i = 0; i < tiles; i++)
+    {
+        Tile t = board->tiles[i];
+        fish[i >> 2] |= (unsigned char)(tile_fish(t) << ((i & 3) * 2));
+        if (tile_owner(t))
         {
-            fprintf(fp, "%d %d\n", board[r][c].fish, board[r][c].owner);
+            put_u32(pen, (uint32_t)i);
+            put_u32(pen + 4, (uint32_t)tile_owner(t));
+            pen += SAVE_PENGUIN_BYTES;
         }
     }
 
-    // close file
-    fclose(fp);
-    return 1;
+    // header last, once the payload it checksums is complete
+    memcpy(buf, SAVE_MAGIC_V2, 8);
+    put_u32(buf + 8, SAVE_VERSION);
+    put_u32(buf + 12, SAVE_HEADER_BYTES);
+    put_u32(buf + 16, (uint32_t)board->rows);
+    put_u32(buf + 20, (uint32_t)board->cols);
+    put_u32(buf + 24, (uint32_t)game->num_players);
+    put_u32(buf + 28, (uint32_t)game->mode);
+    put_u32(buf + 32, (uint32_t)game->turn_index);
+    put_u32(buf + 36, active);
+    put_u32(buf + 40, penguins);
+    put_u64(buf + 48, size - SAVE_HEADER_BYTES);
+    put_u64(buf + SAVE_CHECKSUM_AT,
+            checksum64(buf + SAVE_HEADER_BYTES, size - SAVE_HEADER_BYTES,
+                       checksum64(buf, SAVE_CHECKSUM_AT, 0)));
+}
+
+// Save the game in the binary V2 format: build the file in memory, write it
+// to a temporary file, flush it to disk, then rename it over the old save
+int save_game(const char *filename, const Game *game)
+{
+    unsigned char *buf;
+    size_t size;
+    char tmp[512];
+    int fd, ok;
+
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", filename) >= (int)sizeof(tmp))
+        return 0;
+    buf = save_game_image(game, &size);
+    if (!buf) return 0;
+
+    // a crash leaves either the old save or the complete new one, never half a file
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ok = fd >= 0;
+    if (ok) ok = write_all(fd, buf, size) && fsync(fd) == 0;
+    if (fd >= 0 && close(fd) != 0) ok = 0;
+    if (ok) ok = rename(tmp, filename) == 0;
+    if (!ok && fd >= 0) unlink(tmp);
+
+    free(buf);
+    return ok;
 }
 
-// Load game state from a file and allocate memory for board, players, active flags
-int load_game(const char *filename, Tile ***out_board, int *out_rows,
-                int *out_cols, Player **out_players, int *out_num_players,
-                int *out_mode, int *out_turn_index, int **out_active_flags)
+// Load game state from a V1 text file and allocate memory for board and players
+static int load_game_v1(const char *filename, Game *game)
 {
     FILE *fp;
     char header[64];
     int rows, cols, num_players, mode, turn_index;
-    int *active;
+    int active[MAX_PLAYERS];
     Player *players;
-    Tile **board;
+    Board *board;
     int i, r, c;
 
     // open file for reading
@@ -102,29 +327,29 @@ int load_game(const char *filename, Tile ***out_board, int *out_rows,
     }
 
     // read board dimensions
-    if (fscanf(fp, "%d %d", &rows, &cols) != 2)
+    if (fscanf(fp, "%d %d", &rows, &cols) != 2 ||
+        rows < 1 || rows > BOARD_MAX_SIDE || cols < 1 || cols > BOARD_MAX_SIDE)
     {
         fclose(fp);
         return 0;
     }
 
-    // read number of players, mode, and turn index
-    if (fscanf(fp, "%d %d %d", &num_players, &mode, &turn_index) != 3)
+    // read number of players (2-4), mode, and the turn index of one of them
+    if (fscanf(fp, "%d %d %d", &num_players, &mode, &turn_index) != 3 ||
+        num_players < 2 || num_players > MAX_PLAYERS || turn_index < 0 || turn_index >= num_players)
     {
         fclose(fp);
         return 0;
     }
 
-    // allocate memory for active flags, players, and board
-    active = (int *)malloc(num_players * sizeof(int));
+    // allocate memory for players and board
     players = (Player *)malloc(num_players * sizeof(Player));
     board = create_board(rows, cols);
 
-    if (!active || !players || !board)
+    if (!players || !board)
     {
-        if (active) free(active);
         if (players) free(players);
-        if (board) free_board(board, rows);
+        if (board) free_board(board);
         fclose(fp);
         return 0;
     }
@@ -134,9 +359,8 @@ int load_game(const char *filename, Tile ***out_board, int *out_rows,
     {
         if (fscanf(fp, "%d", &active[i]) != 1)
         {
-            free(active);
             free(players);
-            free_board(board, rows);
+            free_board(board);
             fclose(fp);
             return 0;
         }
@@ -150,9 +374,8 @@ int load_game(const char *filename, Tile ***out_board, int *out_rows,
 
         if (fscanf(fp, "%d %d %d %d %31s", &id, &is_ai, &left, &score, name) != 5)
         {
-            free(active);
             free(players);
-            free_board(board, rows);
+            free_board(board);
             fclose(fp);
             return 0;
         }
@@ -171,131 +394,555 @@ int load_game(const char *filename, Tile ***out_board, int *out_rows,
         for (c = 0; c < cols; c++)
         {
             int fish, owner;
-            if (fscanf(fp, "%d %d", &fish, &owner) != 2)
+            if (fscanf(fp, "%d %d", &fish, &owner) != 2 ||
+                fish < 0 || fish > 3 || owner < 0 || owner > MAX_PLAYERS)
             {
-                free(active);
                 free(players);
-                free_board(board, rows);
+                free_board(board);
                 fclose(fp);
                 return 0;
             }
-            board[r][c].fish = fish;
-            board[r][c].owner = owner;
+            board_set(board, r, c, fish, owner);
         }
     }
 
     // close file after reading all data
     fclose(fp);
 
-    // return all loaded data through output pointers
-    *out_rows = rows;
-    *out_cols = cols;
-    *out_num_players = num_players;
-    *out_mode = mode;
-    *out_turn_index = turn_index;
-    *out_active_flags = active;
-    *out_players = players;
-    *out_board = board;
+    if (!players_valid(players, num_players, mode) || !penguins_fit(board, players, num_players))
+    {
+        free(players);
+        free_board(board);
+        return 0;
+    }
+
+    // return all loaded data through the game struct
+    init_game(game, board, players, num_players, mode);
+    game->turn_index = turn_index;
+    for (i = 0; i < num_players; i++)
+        game->active_flags[i] = active[i];
 
     return 1;
 }
 
+// Check a V2 image (a mapped file or a replay keyframe) and build the game from it.
+// The header is read at fixed offsets and the tiles are unpacked straight into the board.
+int load_game_image(const void *data, size_t size, Game *game)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    uint32_t rows, cols, num_players, mode, turn_index, active, penguins, version;
+    size_t tiles, fish_bytes, rng_bytes;
+    const unsigned char *fish, *pen;
+    Player *players;
+    Board *board;
+    size_t i;
+
+    // version 2 is the same layout without the rng section
+    if (size < SAVE_HEADER_BYTES || memcmp(p, SAVE_MAGIC_V2, 8) != 0)
+        return 0;
+    version = get_u32(p + 8);
+    if (version != 2 && version != SAVE_VERSION)
+        return 0;
+    rng_bytes = version >= 3 ? SAVE_RNG_BYTES : 0;
+
+    rows = get_u32(p + 16);
+    cols = get_u32(p + 20);
+    num_players = get_u32(p + 24);
+    mode = get_u32(p + 28);
+    turn_index = get_u32(p + 32);
+    active = get_u32(p + 36);
+    penguins = get_u32(p + 40);
+    if (rows < 1 || rows > BOARD_MAX_SIDE || cols < 1 || cols > BOARD_MAX_SIDE ||
+        num_players < 2 || num_players > MAX_PLAYERS || turn_index >= num_players)
+        return 0;
+
+    // every section has a known size, so the file size must match exactly
+    tiles = (size_t)rows * cols;
+    fish_bytes = (tiles + 3) / 4;
+    if (get_u32(p + 12) != SAVE_HEADER_BYTES || penguins > tiles ||
+        get_u64(p + 48) != size - SAVE_HEADER_BYTES ||
+        size != SAVE_HEADER_BYTES + num_players * SAVE_PLAYER_BYTES + rng_bytes + fish_bytes +
+                (size_t)penguins * SAVE_PENGUIN_BYTES)
+        return 0;
+
+    if (get_u64(p + SAVE_CHECKSUM_AT) !=
+        checksum64(p + SAVE_HEADER_BYTES, size - SAVE_HEADER_BYTES, checksum64(p, SAVE_CHECKSUM_AT, 0)))
+        return 0;
+
+    players = (Player *)malloc(num_players * sizeof(Player));
+    board = create_board((int)rows, (int)cols);
+    if (!players || !board)
+    {
+        free(players);
+        free_board(board);
+        return 0;
+    }
+
+    for (i = 0; i < num_players; i++)
+    {
+        const unsigned char *q = p + SAVE_HEADER_BYTES + i * SAVE_PLAYER_BYTES;
+        players[i].id = (int)get_u32(q);
+        players[i].is_ai = (int)get_u32(q + 4);
+        players[i].left = (int)get_u32(q + 8);
+        players[i].score = (int)get_u32(q + 12);
+        memcpy(players[i].name, q + 16, sizeof(players[i].name));
+        players[i].name[sizeof(players[i].name) - 1] = '\0';
+    }
+
+    // unpack the fish, put the penguins on them, then derive planes and counters once
+    PROF_SCAN(PROF_SCAN_LOAD, (long)tiles);
+    fish = p + SAVE_HEADER_BYTES + num_players * SAVE_PLAYER_BYTES + rng_bytes;
+    for (i = 0; i < tiles; i++)
+        board->tiles[i] = make_tile((fish[i >> 2] >> ((i & 3) * 2)) & 3, 0);
+
+    pen = fish + fish_bytes;
+    for (i = 0; i < penguins; i++, pen += SAVE_PENGUIN_BYTES)
+    {
+        uint32_t at = get_u32(pen);
+        uint32_t owner = get_u32(pen + 4);
+        if (at >= tiles || owner < 1 || owner > MAX_PLAYERS)
+        {
+            free(players);
+            free_board(board);
+            return 0;
+        }
+        board->tiles[at] = make_tile(tile_fish(board->tiles[at]), (int)owner);
+    }
+    if (!players_valid(players, (int)num_players, (int)mode) || !penguins_fit(board, players, (int)num_players))
+    {
+        free(players);
+        free_board(board);
+        return 0;
+    }
+    board_refresh(board);
+
+    init_game(game, board, players, (int)num_players, (int)mode);
+    game->turn_index = (int)turn_index;
+    for (i = 0; i < num_players; i++)
+        game->active_flags[i] = (active >> i) & 1;
+    if (rng_bytes)
+    {
+        const unsigned char *q = fish - SAVE_RNG_BYTES;
+        game->seed = get_u64(q);
+        game->stream = get_u64(q + 8);
+    }
+    return 1;
+}
+
+// Load a save of either format: V2 files are memory-mapped, anything else goes to the V1 text reader
+int load_game(const char *filename, Game *game)
+{
+    struct stat st;
+    void *map;
+    int fd, ok;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) return 0;
+    if (fstat(fd, &st) != 0 || st.st_size < 8)
+    {
+        close(fd);
+        return load_game_v1(filename, game);
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return 0;
+
+    if (memcmp(map, SAVE_MAGIC_V2, 8) != 0)
+    {
+        munmap(map, (size_t)st.st_size);
+        return load_game_v1(filename, game);
+    }
+
+    ok = load_game_image(map, (size_t)st.st_size, game);
+    munmap(map, (size_t)st.st_size);
+    return ok;
+}
+
+// Append a turn to the autosave journal; autosave stops if the disk refuses it
+static void autosave_turn(Game *game, int kind, int idx, int tile, int dir)
+{
+    if (game->journal && !journal_append(game->journal, game, kind, idx, tile, dir))
+    {
+        game_log(game, "Autosave failed; the game continues without it.\n");
+        game->journal = NULL;
+    }
+}
+
+// Write a fresh autosave snapshot of the current state
+static void autosave_snapshot(Game *game)
+{
+    if (game->journal && !journal_snapshot(game->journal, game))
+    {
+        game_log(game, "Autosave failed; the game continues without it.\n");
+        game->journal = NULL;
+    }
+}
+
+// Claim a 1-fish tile for player idx: collect the fish and put the penguin there
+void game_place_penguin(Game *game, int idx, int r, int c)
+{
+    Player *player = &game->players[idx];
+
+    // update score, board state, and penguins left to place
+    player->score += board_fish(game->board, r, c);
+    board_set(game->board, r, c, 0, player->id);
+    player->left--;
+    game->turns++;
+
+    // the turn passes to the next placer, or to the first mover once placing is over,
+    // so a save or journal taken mid-placement resumes with the right player
+    if (all_penguins_placed(game->players, game->num_players) || !can_place(game->board))
+        game->turn_index = 0;
+    else
+        game->turn_index = (idx + 1) % game->num_players;
+    autosave_turn(game, JOURNAL_PLACE, idx, r * game->board->cols + c, 0);
+    if (game->replay)
+        replay_turn(game->replay, game, REPLAY_PLACE, idx, r * game->board->cols + c, 0, 1);
+}
+
+// Move player idx's penguin from (fr, fc) to (tr, tc): collect the fish, melt the tile left behind and record the move
+void game_make_move(Game *game, int idx, int fr, int fc, int tr, int tc)
+{
+    Board *board = game->board;
+    Player *player = &game->players[idx];
+    UndoStack *h = &game->history;
+    GameMove *m = &h->moves[h->head];
+    int from = fr * board->cols + fc, to = tr * board->cols + tc;
+    int dir = board_move_dir(board, from, to);
+    int i;
+
+    m->player = idx;
+    m->active_mask = 0;
+    for (i = 0; i < game->num_players; i++)
+        if (game->active_flags[i]) m->active_mask |= 1 << i;
+
+    // the dataset keeps the position the move was chosen in
+    if (game->dataset)
+        dataset_move(game->dataset, game, idx, from, to);
+
+    // apply move: board tiles (new and old), then score and turn
+    m->fish = make_move(board, player->id, from, to, &m->board);
+    player->score += m->fish;
+    game->turn_index = (idx + 1) % game->num_players;
+    game->turns++;
+
+    // a new move ends the redo line; when full, the oldest move drops off
+    h->head = (h->head + 1) % UNDO_CAPACITY;
+    if (h->count < UNDO_CAPACITY) h->count++;
+    h->redo = 0;
+    autosave_turn(game, JOURNAL_MOVE, idx, to, dir);
+    if (game->replay)
+        replay_turn(game->replay, game, REPLAY_MOVE, idx, to, dir, m->fish);
+}
+
+// Restore the active flags saved with a move
+static void restore_active(Game *game, int mask)
+{
+    int i;
+    for (i = 0; i < game->num_players; i++)
+        game->active_flags[i] = (mask >> i) & 1;
+}
+
+// Take back the latest move: tiles, score, active players and whose turn it is
+int game_unmake_move(Game *game)
+{
+    UndoStack *h = &game->history;
+    GameMove *m;
+
+    if (h->count == 0)
+        return 0;
+
+    h->head = (h->head + UNDO_CAPACITY - 1) % UNDO_CAPACITY;
+    h->count--;
+    h->redo++;
+    m = &h->moves[h->head];
+
+    unmake_move(game->board, &m->board);
+    game->players[m->player].score -= m->fish;
+    restore_active(game, m->active_mask);
+    game->turn_index = m->player;
+    game->turns--;
+    if (game->replay)
+        replay_unmake(game->replay);
+    if (game->dataset)
+        dataset_unmake(game->dataset);
+    return 1;
+}
+
+// Play the move after the undo point again
+int game_redo_move(Game *game)
+{
+    UndoStack *h = &game->history;
+    GameMove *m;
+
+    if (h->redo == 0)
+        return 0;
+
+    m = &h->moves[h->head];
+    if (game->dataset)
+        dataset_move(game->dataset, game, m->player, m->board.from, m->board.to);
+    make_move(game->board, game->players[m->player].id, m->board.from, m->board.to, NULL);
+    game->players[m->player].score += m->fish;
+    restore_active(game, m->active_mask);
+    game->turn_index = (m->player + 1) % game->num_players;
+    game->turns++;
+
+    h->head = (h->head + 1) % UNDO_CAPACITY;
+    h->count++;
+    h->redo--;
+    if (game->replay)
+        replay_turn(game->replay, game, REPLAY_MOVE, m->player, m->board.to,
+                    board_move_dir(game->board, m->board.from, m->board.to), m->fish);
+    return 1;
+}
+
+// Undo back to the latest human move, so the AI replies after it are taken back too
+static int undo_turn(Game *game)
+{
+    if (!game_unmake_move(game))
+        return 0;
+    while (game->players[game->turn_index].is_ai && game_unmake_move(game))
+        ;
+    return 1;
+}
+
+// Redo one move, plus the AI replies that followed it
+static int redo_turn(Game *game)
+{
+    UndoStack *h = &game->history;
+    if (!game_redo_move(game))
+        return 0;
+    while (h->redo > 0 && game->players[h->moves[h->head].player].is_ai)
+        game_redo_move(game);
+    return 1;
+}
+
+// Let the player's AI engine pick a penguin and a destination. Returns 0 if it has no move.
+static int choose_ai_move(Game *game, int idx, Move *move)
+{
+    Player *player = &game->players[idx];
+    int fish;
+
+    // the engines hand a penguin that is alone in a small region to the exact solver
+    if ((player->is_ai == AI_SEARCH || player->is_ai == AI_MCTS) && game->endgame &&
+        endgame_solve(game->endgame, game->board, player->id, move, &fish))
+    {
+        if (move->from < 0)
+            return 0;
+        game_log(game, "AI is alone in its region and can still collect %d fish.\n", fish);
+        return 1;
+    }
+
+    if (player->is_ai == AI_SEARCH && game->search)
+    {
+        const SearchStats *st;
+        int depth;
+
+        // a reply searched while the human was typing needs no new search
+        if (game->ponder && ponder_reply(game->ponder, game->board, player->id, move, &depth))
+        {
+            game_log(game, "AI had its move ready from your turn (depth %d).\n", depth);
+            return 1;
+        }
+        if (!search_best_move(game->search, game->board, game->num_players, player->id, move))
+            return 0;
+
+        st = search_last_stats(game->search);
+        game_log(game, "AI searched depth %d on %d thread(s): %ld nodes, %.0f nodes/s, TT hit rate %.1f%%.\n",
+                 st->depth, st->threads, st->nodes, st->seconds > 0 ? st->nodes / st->seconds : 0.0,
+                 st->tt_probes ? 100.0 * st->tt_hits / st->tt_probes : 0.0);
+        return 1;
+    }
+
+    if (player->is_ai == AI_MCTS && game->mcts)
+    {
+        const MctsStats *st;
+        int scores[MAX_PLAYERS], i;
+        for (i = 0; i < game->num_players; i++)
+            scores[i] = game->players[i].score;
+        if (!mcts_best_move(game->mcts, game->board, scores, game->num_players, player->id, move))
+            return 0;
+
+        st = mcts_last_stats(game->mcts);
+        game_log(game, "AI ran %ld playouts on %d thread(s): %.0f playouts/s, %ld tree nodes.\n",
+                 st->playouts, st->threads, st->seconds > 0 ? st->playouts / st->seconds : 0.0, st->nodes);
+        return 1;
+    }
+
+    // AI chooses best adjacent move
+    return find_best_adjacent_move(game->board, player->id, move);
+}
+
 // Players place exactly one penguin on a tile with 1 fish, AI auto places
-static void placement_phase(Tile **board, int rows, int cols, Player *players, int num_players)
+static void placement_phase(Game *game)
 {
+    Board *board = game->board;
+    Player *players = game->players;
+    int num_players = game->num_players;
     int p, r, c, ok;
+    int rows = board->rows, cols = board->cols;
 
-    printf("\n=== Placement Phase ===\n");
-    printf("Place your penguin ONLY on an empty tile with exactly 1 fish.\n");
+    game_log(game, "\n=== Placement Phase ===\n");
+    game_log(game, "Place your penguin ONLY on an empty tile with exactly 1 fish.\n");
+    PROF_PHASE_BEGIN(PROF_PLACEMENT);
 
-    // placement continues until all penguins placed or no valid tiles left
-    while (1)
+    // placement continues until all penguins placed or no valid tiles left,
+    // in turn order from the player whose turn it is (not seat 0 after a load)
+    while (!all_penguins_placed(players, num_players) && can_place(board))
     {
-        int done = 1;
-        for (p = 0; p < num_players; p++)
-            if (players[p].left > 0)
-                done = 0;
-
-        if (done || !can_place(board, rows, cols))
-            break;
+        p = game->turn_index % num_players;
+        game->turn_index = (p + 1) % num_players;
+        if (players[p].left == 0)
+            continue;
 
-        for (p = 0; p < num_players; p++)
+        if (players[p].is_ai)
         {
-            if (players[p].left == 0)
+            // AI auto placement: the engines score every tile, greedy takes the first
+            PROF_AI_BEGIN();
+            if ((players[p].is_ai == AI_SEARCH || players[p].is_ai == AI_MCTS) && game->placement)
+                ok = placement_choose(game->placement, board, &r, &c);
+            else
+                ok = find_first_placement(board, &r, &c);
+            PROF_AI_END();
+            if (!ok)
+            {
+                game_log(game, "AI could not find a valid placement.\n");
                 continue;
+            }
+            game_log(game, "AI places penguin at row %d col %d.\n", r + 1, c + 1);
+        }
+        else
+        {
+            // human player input loop for placement
+            ok = 0;
+            while (!ok)
+            {
+                // on a board larger than the screen, show a part with free 1-fish tiles
+                int focus = find_first_placement(board, &r, &c) ? r * cols + c : -1;
+                render_board(game->view, board, focus);
+                printf("Player %d (%s): score=%d\n",
+                       players[p].id, players[p].name, players[p].score);
+                printf("Enter row and column to place penguin (1-%d 1-%d): ", rows, cols);
+
+                if (scanf("%d %d", &r, &c) != 2)
+                {
+                    printf("Invalid input. Exiting.\n");
+                    exit(1);
+                }
 
-            if (!can_place(board, rows, cols))
-                break;
+                r--; c--;
 
-            if (players[p].is_ai)
-            {
-                // AI auto placement: find first valid tile
-                if (!find_first_placement(board, rows, cols, &r, &c))
+                if (r < 0 || r >= rows || c < 0 || c >= cols)
+                {
+                    printf("Out of bounds.\n");
+                    continue;
+                }
+                if (board_fish(board, r, c) != 1)
+                {
+                    printf("Invalid: tile must have exactly 1 fish.\n");
+                    continue;
+                }
+                if (board_owner(board, r, c) != 0)
                 {
-                    printf("AI could not find a valid placement.\n");
+                    printf("Invalid: tile is occupied.\n");
                     continue;
                 }
-                printf("AI places penguin at row %d col %d.\n", r + 1, c + 1);
+
+                ok = 1;
             }
-            else
-            {
-                // human player input loop for placement
-                ok = 0;
-                while (!ok)
-                {                  
-                    print_board(board, rows, cols);
-                    printf("Player %d (%s): score=%d\n",
-                           players[p].id, players[p].name, players[p].score);
-                    printf("Enter row and column to place penguin (1-%d 1-%d): ", rows, cols);
-
-                    if (scanf("%d %d", &r, &c) != 2)
-                    {
-                        printf("Invalid input. Exiting.\n");
-                        exit(1);
-                    }
+        }
 
-                    r--; c--;
+        game_place_penguin(game, p, r, c);
+    }
+    PROF_PHASE_END(PROF_PLACEMENT);
+}
 
-                    if (r < 0 || r >= rows || c < 0 || c >= cols)
-                    {
-                        printf("Out of bounds.\n");
-                        continue;
-                    }
-                    if (board[r][c].fish != 1)
-                    {
-                        printf("Invalid: tile must have exactly 1 fish.\n");
-                        continue;
-                    }
-                    if (board[r][c].owner != 0)
-                    {
-                        printf("Invalid: tile is occupied.\n");
-                        continue;
-                    }
+// Mark a player inactive for the rest of the game
+static void drop_player(Game *game, int idx)
+{
+    game->active_flags[idx] = 0;
+    if (game->replay)
+        replay_turn(game->replay, game, REPLAY_INACTIVE, idx, 0, 0, 0);
+}
 
-                    ok = 1;
-                }
-            }
+// Check if every active player is an AI whose penguins are each alone in a region
+// the solver takes. Without undo a penguin once alone stays alone, so players found
+// alone are remembered in *alone (bit i = player index i) and not checked again.
+static int all_alone(const Game *game, int *alone)
+{
+    int i;
+    for (i = 0; i < game->num_players; i++)
+    {
+        if (!game->active_flags[i] || (*alone >> i & 1))
+            continue;
+        if (!game->players[i].is_ai || endgame_region(game->board, game->players[i].id) < 0)
+            return 0;
+        *alone |= 1 << i;
+    }
+    return 1;
+}
+
+// Check if some player's moves come from an engine rather than the greedy rule
+static int uses_engine(const Game *game)
+{
+    int i;
+    for (i = 0; i < game->num_players; i++)
+        if (game->players[i].is_ai == AI_SEARCH || game->players[i].is_ai == AI_MCTS)
+            return 1;
+    return 0;
+}
+
+// Once nobody can reach anybody else, turn order no longer matters: play each
+// player's remaining moves back to back and drop it when it is stuck
+static void fast_forward(Game *game)
+{
+    int cols = game->board->cols;
+    int first = game->turn_index, k;
+    Move m;
 
-            // update score, board state, and penguins left to place
-            players[p].score += board[r][c].fish;
-            board[r][c].fish = 0;
-            board[r][c].owner = players[p].id;
-            players[p].left--;
+    for (k = 0; k < game->num_players; k++)
+    {
+        int idx = (first + k) % game->num_players;
+        if (!game->active_flags[idx])
+            continue;
+        while (choose_ai_move(game, idx, &m))
+        {
+            game_make_move(game, idx, m.from / cols, m.from % cols, m.to / cols, m.to % cols);
+            game->fast_forwarded++;
         }
+        drop_player(game, idx);
     }
 }
 
 // Players move 1 step with rules, AI chooses simple move, humans can save & quit
-static void movement_phase(Tile **board, int rows, int cols, Player *players, int num_players, int mode, int *turn_index_io, int *active_flags)
+static void movement_phase(Game *game)
 {
+    Board *board = game->board;
+    Player *players = game->players;
+    int num_players = game->num_players;
+    int *active_flags = game->active_flags;
     int active_count = 0;
+    int alone = 0;
     int p;
 
-    printf("\n=== Movement Phase ===\n");
-    printf("Move your penguin 1 step: up/down/left/right.\n");
-    printf("You cannot move onto empty water (--) or onto occupied tiles.\n");
-    printf("If a player cannot move, they will be skipped for the rest of the game.\n");
-    printf("Human can enter Q to SAVE and QUIT during movement.\n");
+    // finishing at once only saves work when an engine would search every remaining move
+    int fast = game->quiet && game->endgame && uses_engine(game);
+
+    game_log(game, "\n=== Movement Phase ===\n");
+    game_log(game, "Move your penguin 1 step: up/down/left/right.\n");
+    game_log(game, "You cannot move onto empty water (--) or onto occupied tiles.\n");
+    game_log(game, "If a player cannot move, they will be skipped for the rest of the game.\n");
+    game_log(game, "Human can enter U to UNDO and R to REDO moves, or Q to SAVE and QUIT during movement.\n");
+    if (game->ponder)
+        game_log(game, "Enter H for a hint; it is worked out while you think.\n");
+
+    PROF_PHASE_BEGIN(PROF_MOVEMENT);
+
+    // the placements are folded into one snapshot before the first move
+    if (game->journal && journal_records(game->journal) > 0)
+        autosave_snapshot(game);
 
     // count how many players are active (can still move)
     for (p = 0; p < num_players; p++)
@@ -305,39 +952,46 @@ static void movement_phase(Tile **board, int rows, int cols, Player *players, in
     while (active_count > 0)
     {
         int any_move = 0;
-        int start = *turn_index_io;
         int loops = 0;
 
+        // headless games whose penguins are all walled off finish at once
+        if (fast && all_alone(game, &alone))
+        {
+            fast_forward(game);
+            break;
+        }
+
         // loop through players in turn order
         while (loops < num_players)
         {
-            int idx = (*turn_index_io) % num_players;
+            int idx = game->turn_index % num_players;
             int pr, pc;
             int tr, tc;
+            int rewound = 0;
 
             // update turn index to next player
-            (*turn_index_io) = (idx + 1) % num_players;
+            game->turn_index = (idx + 1) % num_players;
             loops++;
 
             if (!active_flags[idx])
                 continue;
 
             // check if player can move any penguin
-            if (!player_can_move(board, rows, cols, players[idx].id))
+            if (!player_can_move(board, players[idx].id))
             {
-                printf("\nPlayer %d (%s) cannot move anymore and is now inactive.\n",
-                       players[idx].id, players[idx].name);
-                active_flags[idx] = 0;
+                game_log(game, "\nPlayer %d (%s) cannot move anymore and is now inactive.\n",
+                         players[idx].id, players[idx].name);
+                drop_player(game, idx);
                 active_count--;
                 if (active_count == 0) break;
                 continue;
             }
 
-            // find current penguin position for player
-            if (!find_penguin(board, rows, cols, players[idx].id, &pr, &pc))
+            // make sure the player still has a penguin on the board
+            if (!find_penguin(board, players[idx].id, &pr, &pc))
             {
-                printf("\nError: penguin for Player %d not found.\n", players[idx].id);
-                active_flags[idx] = 0;
+                game_log(game, "\nError: penguin for Player %d not found.\n", players[idx].id);
+                drop_player(game, idx);
                 active_count--;
                 if (active_count == 0) break;
                 continue;
@@ -345,31 +999,66 @@ static void movement_phase(Tile **board, int rows, int cols, Player *players, in
 
             if (players[idx].is_ai)
             {
-                // AI chooses best adjacent move
-                if (!find_best_adjacent_move(board, rows, cols, players[idx].id, &tr, &tc))
+                Move m;
+                int found;
+                PROF_AI_BEGIN();
+                found = choose_ai_move(game, idx, &m);
+                PROF_AI_END();
+                if (!found)
                 {
-                    printf("AI has no valid moves.\n");
-                    active_flags[idx] = 0;
+                    game_log(game, "AI has no valid moves.\n");
+                    drop_player(game, idx);
                     active_count--;
                     if (active_count == 0) break;
                     continue;
                 }
-                printf("AI moves to row %d col %d.\n", tr + 1, tc + 1);
+                pr = m.from / board->cols;
+                pc = m.from % board->cols;
+                tr = m.to / board->cols;
+                tc = m.to % board->cols;
+                game_log(game, "AI moves from row %d col %d to row %d col %d.\n", pr + 1, pc + 1, tr + 1, tc + 1);
             }
 
             else
             {
+                const int *own = board->penguins[players[idx].id];
+                int count = board->num_penguins[players[idx].id];
+                int sel = 0;
+
+                // start with the first penguin that can move
+                while (sel + 1 < count && !board_move_mask(board, own[sel] / board->cols, own[sel] % board->cols))
+                    sel++;
+
                 // human player input loop for WASD movement
                 while (1)
                 {
                     char cmd;
-                    int nr = pr, nc = pc;
-                    
-                    print_board(board, rows, cols);
+                    int nr, nc;
+
+                    pr = own[sel] / board->cols;
+                    pc = own[sel] % board->cols;
+                    nr = pr;
+                    nc = pc;
+
+                    // think in the background until the human's command changes the game
+                    if (game->ponder)
+                        ponder_start(game->ponder, game, idx);
+
+                    render_board(game->view, board, own[sel]);
                     printf("Player %d (%s): score=%d\n", players[idx].id, players[idx].name, players[idx].score);
-                    printf("Your penguin is at: row %d col %d\n", pr + 1, pc + 1);
+                    if (count == 1)
+                        printf("Your penguin is at: row %d col %d\n", pr + 1, pc + 1);
+                    else
+                    {
+                        int k;
+                        for (k = 0; k < count; k++)
+                            printf("%c%d) penguin at row %d col %d\n", k == sel ? '*' : ' ', k + 1,
+                                   own[k] / board->cols + 1, own[k] % board->cols + 1);
+                        printf("Pick a penguin with 1-%d, optionally followed by a move.\n", count);
+                    }
 
-                    printf("Move with W/A/S/D (1 step). (Q = save & quit)\n");
+                    printf("Move with W/A/S/D (1 step). (%sU = undo, R = redo, Q = save & quit)\n",
+                           game->ponder ? "H = hint, " : "");
                     printf("Enter command: ");
 
                     {
@@ -393,6 +1082,27 @@ static void movement_phase(Tile **board, int rows, int cols, Player *players, in
                             }
                         }
 
+                        /* a leading penguin number picks the penguin, the next character is the move */
+                        if (count > 1 && cmd >= '1' && cmd <= '0' + count)
+                        {
+                            sel = cmd - '1';
+                            cmd = '\0';
+                            for (k++; line[k] != '\0'; k++)
+                            {
+                                if (line[k] != ' ' && line[k] != '\t' && line[k] != '\n' && line[k] != '\r')
+                                {
+                                    cmd = line[k];
+                                    break;
+                                }
+                            }
+                            if (cmd == '\0')
+                                continue;
+                            pr = own[sel] / board->cols;
+                            pc = own[sel] % board->cols;
+                            nr = pr;
+                            nc = pc;
+                        }
+
                         if (cmd == '\0')
                         {
                             printf("Invalid command. Use W/A/S/D.\n");
@@ -407,9 +1117,31 @@ static void movement_phase(Tile **board, int rows, int cols, Player *players, in
                     else if (cmd == 's') nr = pr + 1;
                     else if (cmd == 'a') nc = pc - 1;
                     else if (cmd == 'd') nc = pc + 1;
+                    else if (cmd == 'h')
+                    {
+                        Move hint;
+                        int depth, k;
+
+                        if (!game->ponder || !ponder_hint(game->ponder, &hint, &depth))
+                        {
+                            printf("No hint available.\n");
+                            continue;
+                        }
+                        for (k = 0; k < count && own[k] != hint.from; k++)
+                            ;
+                        if (count == 1)
+                            printf("Hint: %c, to row %d col %d (searched depth %d).\n", "wsad"[hint.dir],
+                                   hint.to / board->cols + 1, hint.to % board->cols + 1, depth);
+                        else
+                            printf("Hint: %d%c, penguin %d to row %d col %d (searched depth %d).\n", k + 1,
+                                   "wsad"[hint.dir], k + 1, hint.to / board->cols + 1, hint.to % board->cols + 1, depth);
+                        continue;
+                    }
                     else if (cmd == 'q')
                     {
-                        if (save_game(SAVE_FILE, board, rows, cols, players, num_players, mode, *turn_index_io, active_flags))
+                        if (game->ponder)
+                            ponder_stop(game->ponder);
+                        if (game->journal ? journal_snapshot(game->journal, game) : save_game(SAVE_FILE, game))
                         {
                             printf("Game saved to %s. Exiting now.\n", SAVE_FILE);
                         }
@@ -417,9 +1149,26 @@ static void movement_phase(Tile **board, int rows, int cols, Player *players, in
                         {
                             printf("Failed to save game.\n");
                         }
+                        if (game->replay)
+                            replay_finish(game->replay);
+                        PROF_PHASE_END(PROF_MOVEMENT);
                         exit(0);
                     }
-                    
+                    else if (cmd == 'u' || cmd == 'r')
+                    {
+                        if (game->ponder)
+                            ponder_stop(game->ponder);
+                        if (!(cmd == 'u' ? undo_turn(game) : redo_turn(game)))
+                        {
+                            printf(cmd == 'u' ? "Nothing to undo.\n" : "Nothing to redo.\n");
+                            continue;
+                        }
+                        // the journal only goes forward, so a rewind starts a new snapshot
+                        autosave_snapshot(game);
+                        rewound = 1;
+                        break;
+                    }
+
                     else
                     {
                         printf("Invalid command. Use W/A/S/D.\n");
@@ -429,23 +1178,30 @@ static void movement_phase(Tile **board, int rows, int cols, Player *players, in
                     tr = nr;
                     tc = nc;
 
-                    if (!is_valid_move(board, rows, cols, players[idx].id, pr, pc, tr, tc))
+                    if (!is_valid_move(board, players[idx].id, pr, pc, tr, tc))
                     {
                         printf("Invalid move.\n");
                         continue;
                     }
                     break;
                 }
-            }
 
-            // apply move: update score, board tiles (new and old)
-            players[idx].score += board[tr][tc].fish;
-            board[tr][tc].fish = 0;
-            board[tr][tc].owner = players[idx].id;
+                if (game->ponder)
+                    ponder_stop(game->ponder);
+            }
 
-            board[pr][pc].owner = 0;
-            board[pr][pc].fish = 0;
+            // after an undo or redo the turn order restarts from the restored position
+            if (rewound)
+            {
+                active_count = 0;
+                for (p = 0; p < num_players; p++)
+                    if (active_flags[p]) active_count++;
+                loops = 0;
+                any_move = 1;
+                continue;
+            }
 
+            game_make_move(game, idx, pr, pc, tr, tc);
             any_move = 1;
         }
 
@@ -454,39 +1210,39 @@ static void movement_phase(Tile **board, int rows, int cols, Player *players, in
             break;
     }
 
-    printf("\nNo players can move. Game over.\n");
+    PROF_PHASE_END(PROF_MOVEMENT);
+    game_log(game, "\nNo players can move. Game over.\n");
 }
 
 // Start a new game: placement phase first, then movement with fresh state
-void play_game(Tile **board, int rows, int cols, Player *players, int num_players)
+void play_game(Game *game)
 {
-    placement_phase(board, rows, cols, players, num_players);
-    {
-        // allocate memory for active player flags
-        int *active_flags = (int *)malloc(num_players * sizeof(int));
-        int turn_index = 0;
-        int i;
-
-        if (!active_flags)
-        {
-            printf("Memory allocation failed.\n");
-            return;
-        }
-
-        // set all players as active at start
-        for (i = 0; i < num_players; i++)
-            active_flags[i] = 1;
-
-        // call movement phase to play the game
-        movement_phase(board, rows, cols, players, num_players, 1, &turn_index, active_flags);
-
-        // free active flags memory after game ends
-        free(active_flags);
-    }
+    autosave_snapshot(game);
+    if (game->replay)
+        replay_begin(game->replay, game);
+    if (game->dataset)
+        dataset_begin(game->dataset, game);
+    placement_phase(game);
+    movement_phase(game);
+    if (game->replay && !replay_finish(game->replay))
+        game_log(game, "Failed to write the replay.\n");
+    if (game->dataset && !dataset_finish(game->dataset, game))
+        game_log(game, "Failed to write the dataset.\n");
 }
 
-// Continue game from loaded state: skip placement, continue movement phase
-void continue_game(Tile **board, int rows, int cols, Player *players, int num_players, int mode, int turn_index, int *active_flags)
+// Continue game from loaded state: finish any placements left, then the movement phase
+void continue_game(Game *game)
 {
-    movement_phase(board, rows, cols, players, num_players, mode, &turn_index, active_flags);
-}
\ No newline at end of file
+    autosave_snapshot(game);
+    if (game->replay)
+        replay_begin(game->replay, game);
+    if (game->dataset)
+        dataset_begin(game->dataset, game);
+    if (!all_penguins_placed(game->players, game->num_players) && can_place(game->board))
+        placement_phase(game);
+    movement_phase(game);
+    if (game->replay && !replay_finish(game->replay))
+        game_log(game, "Failed to write the replay.\n");
+    if (game->dataset && !dataset_finish(game->dataset, game))
+        game_log(game, "Failed to write the dataset.\n");
+}
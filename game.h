@@ -6,29 +6,123 @@
 
 #include "board.h"
 #include "players.h"
+#include "search.h"
+#include "mcts.h"
+#include "endgame.h"
+#include "placement.h"
+#include "render.h"
 
-// This is the filename used to store the game save.
-#define SAVE_FILE "savegame.txt"
+// This is the filename used to store the game save (binary V2 format).
+#define SAVE_FILE "savegame.dat"
+
+// Older text (V1) saves are still offered and loaded from this file.
+#define SAVE_FILE_V1 "savegame.txt"
+
+// Game modes, as stored in the save file.
+#define MODE_PVP  1
+#define MODE_PVAI 2
+
+// Movement-phase moves the undo history keeps; older ones drop off.
+#define UNDO_CAPACITY 256
+
+// One movement-phase move as recorded for undo and redo.
+typedef struct {
+    MoveDelta board;     // the two tiles the move changed
+    int player;          // index of the player who moved
+    int fish;            // fish collected
+    int active_mask;     // active_flags before the move, bit i = player index i
+} GameMove;
+
+// Ring buffer of the latest moves. The count moves before head can be
+// undone; the redo moves from head on were undone and can be played again.
+typedef struct {
+    GameMove moves[UNDO_CAPACITY];
+    int head;            // slot the next move is written to
+    int count;
+    int redo;
+} UndoStack;
+
+// Autosave journal, see journal.h.
+typedef struct Journal Journal;
+
+// Replay recorder, see replay.h.
+typedef struct Replay Replay;
+
+// Training dataset writer, see dataset.h.
+typedef struct Dataset Dataset;
+
+// Background thinking during human turns, see ponder.h.
+typedef struct Ponder Ponder;
+
+// This struct holds everything about one game in progress.
+typedef struct {
+    Board *board;                   // the board, owned by the caller
+    Player *players;                // num_players players, owned by the caller
+    int num_players;                // 2-4
+    int mode;                       // MODE_PVP or MODE_PVAI
+    int turn_index;                 // index of the next player to place (0 once placing ends), then to move
+    int active_flags[MAX_PLAYERS];  // 1 while a player can still move
+    int quiet;                      // 1 = headless: never print or read from the terminal
+    int turns;                      // placements and moves made since the game started or was loaded
+    Search *search;                 // engine for AI_SEARCH players, owned by the caller; NULL = play greedy
+    Mcts *mcts;                     // engine for AI_MCTS players, owned by the caller; NULL = play greedy
+    Endgame *endgame;               // solver for penguins alone in a region, owned by the caller; NULL = off
+    Placement *placement;           // picks AI_SEARCH and AI_MCTS placements, owned by the caller; NULL = first free tile
+    Ponder *ponder;                 // thinks while humans move: hints and AI_SEARCH replies, owned by the caller; NULL = off
+    int fast_forwarded;             // moves played back to back once every penguin was alone (headless only)
+    Renderer *view;                 // draws the board for human players, owned by the caller
+    UndoStack history;              // movement-phase moves for undo / redo: empty after load_game,
+                                    // the moves the journal replayed after journal_resume
+    Journal *journal;               // autosave journal, owned by the caller; NULL = no autosave
+    Replay *replay;                 // records the game, owned by the caller; NULL = no replay
+    Dataset *dataset;               // collects training samples, owned by the caller; NULL = off
+    uint64_t seed;                  // seed the board was generated from, 0 if unknown (kept in saves and replays)
+    uint64_t stream;                // rng stream of that seed
+} Game;
+
+// Set up a game around an existing board and players: everyone active, turn 0.
+void init_game(Game *game, Board *board, Player *players, int num_players, int mode);
 
 // Start a new game, including placement and movement phases.
-void play_game(Tile **board, int rows, int cols,
-               Player *players, int num_players);
-
-// Resume a saved game directly from the movement phase.
-void continue_game(Tile **board, int rows, int cols,
-                   Player *players, int num_players,
-                   int mode, int turn_index, int *active_flags);
-
-// Save the current game state to a file.
-int save_game(const char *filename,
-              Tile **board, int rows, int cols,
-              Player *players, int num_players,
-              int mode, int turn_index, int *active_flags);
-
-// Load a saved game and create memory for board and players.
-int load_game(const char *filename,
-              Tile ***out_board, int *out_rows, int *out_cols,
-              Player **out_players, int *out_num_players,
-              int *out_mode, int *out_turn_index, int **out_active_flags);
-
-#endif
\ No newline at end of file
+void play_game(Game *game);
+
+// Resume a saved game: finish the placement phase if it was cut short, then movement.
+void continue_game(Game *game);
+
+// Place player idx's penguin on the 1-fish tile (r, c) and collect the fish.
+// The placement must be legal.
+void game_place_penguin(Game *game, int idx, int r, int c);
+
+// Move player idx's penguin on (fr, fc) to (tr, tc), collect the fish and record the move for undo.
+// Any moves waiting to be redone are dropped. The move must be legal.
+void game_make_move(Game *game, int idx, int fr, int fc, int tr, int tc);
+
+// Take back the latest recorded move, including its score and turn. Returns 0 if there is none.
+int game_unmake_move(Game *game);
+
+// Play the latest taken-back move again. Returns 0 if there is none.
+int game_redo_move(Game *game);
+
+// Save the current game state to a file in the binary V2 format.
+// The file is replaced atomically: a failed save leaves the old one intact.
+int save_game(const char *filename, const Game *game);
+
+// Build the V2 save image of the game in a new buffer and store its length in *size.
+// Returns NULL if out of memory; the caller frees the buffer.
+unsigned char *save_game_image(const Game *game, size_t *size);
+
+// Bytes of the V2 save image of the game as it stands.
+size_t save_game_image_size(const Game *game);
+
+// Build the V2 save image in buf, which holds size = save_game_image_size(game) bytes.
+void save_game_image_to(const Game *game, unsigned char *buf, size_t size);
+
+// Build a game from a V2 image in memory, with the same checks as load_game.
+// The caller frees game->board and game->players.
+int load_game_image(const void *data, size_t size, Game *game);
+
+// Load a saved game (V2 binary or V1 text) and create memory for board and players.
+// The caller frees game->board and game->players.
+int load_game(const char *filename, Game *game);
+
+#endif
@@ -0,0 +1,331 @@
+/* This file implements the autosave journal declared in journal.h.
+   Journal layout, all integers little-endian:
+     header (32 bytes): magic, version, record size, snapshot id, reserved
+     records (8 bytes each): kind, player index, check, tile index
+   The kind byte holds the record kind in its low four bits and, from version
+   2 on, the direction of a move in the next two, which tells which of the
+   player's penguins moved. Version 1 journals (one penguin each) still replay.
+   The snapshot id is the checksum field of the snapshot's header, so a
+   journal left over from an older snapshot is never replayed on a newer one.
+   A record's check is the low 16 bits of XXH64 over the record and its
+   position, which stops the replay at a torn or damaged tail. Records are
+   appended with one write() each, so every turn costs 8 bytes of I/O. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "journal.h"
+#include "checksum.h"
+
+#define JOURNAL_MAGIC        "PENGJRN1"
+#define JOURNAL_VERSION      2
+#define JOURNAL_HEADER_BYTES 32
+#define JOURNAL_RECORD_BYTES 8
+
+// Where the snapshot keeps its checksum (see the V2 layout in game.c)
+#define SNAPSHOT_MAGIC       "PENGSAV2"
+#define SNAPSHOT_HEADER_BYTES 64
+#define SNAPSHOT_CHECKSUM_AT 56
+
+// Records read from the journal at a time while replaying
+#define REPLAY_BATCH 512
+
+struct Journal {
+    char *snapshot_file;
+    char *journal_file;
+    int fd;              // journal opened for appending, -1 before the first snapshot
+    int records;         // records since the snapshot
+    uint64_t id;         // checksum of the snapshot the records apply to
+};
+
+// Store a 32-bit value little-endian
+static void put_u32(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+// Store a 64-bit value little-endian
+static void put_u64(unsigned char *p, uint64_t v)
+{
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+// Read a little-endian 32-bit value
+static uint32_t get_u32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Read a little-endian 64-bit value
+static uint64_t get_u64(const unsigned char *p)
+{
+    return (uint64_t)get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+
+// Read exactly len bytes; returns the number actually read
+static size_t read_full(int fd, unsigned char *p, size_t len)
+{
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t n = read(fd, p + done, len - done);
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    return done;
+}
+
+// Read the id (header checksum) of a V2 snapshot file
+static int snapshot_id(const char *filename, uint64_t *id)
+{
+    unsigned char header[SNAPSHOT_HEADER_BYTES];
+    int fd = open(filename, O_RDONLY);
+    size_t n;
+
+    if (fd < 0) return 0;
+    n = read_full(fd, header, sizeof(header));
+    close(fd);
+    if (n != sizeof(header) || memcmp(header, SNAPSHOT_MAGIC, 8) != 0)
+        return 0;
+
+    *id = get_u64(header + SNAPSHOT_CHECKSUM_AT);
+    return 1;
+}
+
+// Check value of a record: it depends on the record's bytes, its position and the snapshot
+static uint16_t record_check(const unsigned char *rec, uint32_t seq, uint64_t id)
+{
+    unsigned char buf[JOURNAL_RECORD_BYTES + 4];
+
+    memcpy(buf, rec, JOURNAL_RECORD_BYTES);
+    buf[2] = 0;
+    buf[3] = 0;
+    put_u32(buf + JOURNAL_RECORD_BYTES, seq);
+    return (uint16_t)checksum64(buf, sizeof(buf), id);
+}
+
+// Duplicate a file name
+static char *copy_name(const char *s)
+{
+    char *d = malloc(strlen(s) + 1);
+    if (d) strcpy(d, s);
+    return d;
+}
+
+// Create a journal for the given files; nothing is written yet
+Journal *journal_create(const char *snapshot_file, const char *journal_file)
+{
+    Journal *journal = calloc(1, sizeof(Journal));
+    if (!journal) return NULL;
+
+    journal->snapshot_file = copy_name(snapshot_file);
+    journal->journal_file = copy_name(journal_file);
+    journal->fd = -1;
+    if (!journal->snapshot_file || !journal->journal_file)
+    {
+        journal_free(journal);
+        return NULL;
+    }
+    return journal;
+}
+
+// Close the journal file and free the journal
+void journal_free(Journal *journal)
+{
+    if (!journal) return;
+    if (journal->fd >= 0)
+        close(journal->fd);
+    free(journal->snapshot_file);
+    free(journal->journal_file);
+    free(journal);
+}
+
+// Write a new snapshot, then restart the journal with a header naming it.
+// The snapshot is renamed into place first: a crash in between leaves the
+// old journal, whose id no longer matches, so it is simply ignored.
+int journal_snapshot(Journal *journal, const Game *game)
+{
+    unsigned char header[JOURNAL_HEADER_BYTES];
+
+    if (journal->fd >= 0)
+    {
+        close(journal->fd);
+        journal->fd = -1;
+    }
+    journal->records = 0;
+
+    if (!save_game(journal->snapshot_file, game) || !snapshot_id(journal->snapshot_file, &journal->id))
+        return 0;
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, JOURNAL_MAGIC, 8);
+    put_u32(header + 8, JOURNAL_VERSION);
+    put_u32(header + 12, JOURNAL_RECORD_BYTES);
+    put_u64(header + 16, journal->id);
+
+    journal->fd = open(journal->journal_file, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (journal->fd < 0)
+        return 0;
+    if (write(journal->fd, header, sizeof(header)) != (ssize_t)sizeof(header))
+    {
+        close(journal->fd);
+        journal->fd = -1;
+        return 0;
+    }
+    return 1;
+}
+
+// Append one record with a single write, or compact once the journal is full
+int journal_append(Journal *journal, const Game *game, int kind, int idx, int tile, int dir)
+{
+    unsigned char rec[JOURNAL_RECORD_BYTES];
+    uint16_t check;
+
+    if (journal->fd < 0)
+        return 0;
+
+    // the game already includes this turn, so a new snapshot replaces the record
+    if (journal->records >= JOURNAL_COMPACT_EVERY)
+        return journal_snapshot(journal, game);
+
+    rec[0] = (unsigned char)(kind | dir << 4);
+    rec[1] = (unsigned char)idx;
+    put_u32(rec + 4, (uint32_t)tile);
+    check = record_check(rec, (uint32_t)journal->records, journal->id);
+    rec[2] = (unsigned char)check;
+    rec[3] = (unsigned char)(check >> 8);
+
+    if (write(journal->fd, rec, sizeof(rec)) != (ssize_t)sizeof(rec))
+        return 0;
+    journal->records++;
+    return 1;
+}
+
+// Records since the latest snapshot
+int journal_records(const Journal *journal)
+{
+    return journal->records;
+}
+
+// Delete both files; the journal writes nothing more until the next snapshot
+void journal_discard(Journal *journal)
+{
+    if (journal->fd >= 0)
+    {
+        close(journal->fd);
+        journal->fd = -1;
+    }
+    journal->records = 0;
+    unlink(journal->journal_file);
+    unlink(journal->snapshot_file);
+}
+
+// Apply one record if it is a legal turn in the current position; dir is -1
+// for a version 1 move, made by the player's only penguin
+static int replay_record(Game *game, int kind, int idx, uint32_t tile, int dir)
+{
+    Board *board = game->board;
+    int pr, pc, tr, tc, id, from;
+
+    if (idx >= game->num_players || tile >= (uint32_t)board->rows * (uint32_t)board->cols)
+        return 0;
+    id = game->players[idx].id;
+    tr = (int)tile / board->cols;
+    tc = (int)tile % board->cols;
+
+    if (kind == JOURNAL_PLACE)
+    {
+        if (game->players[idx].left <= 0 || board_fish(board, tr, tc) != 1 || board_owner(board, tr, tc) != 0)
+            return 0;
+        game_place_penguin(game, idx, tr, tc);
+        return 1;
+    }
+
+    if (kind == JOURNAL_MOVE)
+    {
+        if (dir < 0)
+        {
+            if (!find_penguin(board, id, &pr, &pc))
+                return 0;
+        }
+        else
+        {
+            from = board_move_source(board, (int)tile, dir);
+            if (from < 0 || from >= board->rows * board->cols || board_move_dir(board, from, (int)tile) != dir)
+                return 0;
+            pr = from / board->cols;
+            pc = from % board->cols;
+            if (board_owner(board, pr, pc) != id)
+                return 0;
+        }
+        if (!is_valid_move(board, id, pr, pc, tr, tc))
+            return 0;
+        game_make_move(game, idx, pr, pc, tr, tc);
+        return 1;
+    }
+    return 0;
+}
+
+// Load the snapshot, then replay every intact record written for it
+int journal_resume(const char *snapshot_file, const char *journal_file, Game *game, int *replayed)
+{
+    unsigned char header[JOURNAL_HEADER_BYTES];
+    unsigned char batch[REPLAY_BATCH * JOURNAL_RECORD_BYTES];
+    uint64_t id;
+    uint32_t seq = 0, version;
+    int fd, done = 0;
+
+    *replayed = 0;
+    if (!load_game(snapshot_file, game))
+        return 0;
+
+    // a missing, foreign or stale journal just means there is nothing to replay
+    if (!snapshot_id(snapshot_file, &id))
+        return 1;
+    fd = open(journal_file, O_RDONLY);
+    if (fd < 0)
+        return 1;
+    if (read_full(fd, header, sizeof(header)) != sizeof(header) ||
+        memcmp(header, JOURNAL_MAGIC, 8) != 0 ||
+        (version = get_u32(header + 8)) < 1 || version > JOURNAL_VERSION ||
+        get_u32(header + 12) != JOURNAL_RECORD_BYTES ||
+        get_u64(header + 16) != id)
+    {
+        close(fd);
+        return 1;
+    }
+
+    while (!done)
+    {
+        size_t n = read_full(fd, batch, sizeof(batch)) / JOURNAL_RECORD_BYTES;
+        size_t i;
+
+        if (n < REPLAY_BATCH)
+            done = 1;
+        for (i = 0; i < n; i++, seq++)
+        {
+            const unsigned char *rec = batch + i * JOURNAL_RECORD_BYTES;
+            uint16_t check = (uint16_t)(rec[2] | rec[3] << 8);
+            int kind = version >= 2 ? rec[0] & 15 : rec[0];
+            int dir = version >= 2 ? rec[0] >> 4 & 3 : -1;
+
+            if (check != record_check(rec, seq, id) || !replay_record(game, kind, rec[1], get_u32(rec + 4), dir))
+            {
+                done = 1;
+                break;
+            }
+            (*replayed)++;
+        }
+    }
+
+    close(fd);
+    return 1;
+}
@@ -0,0 +1,49 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+// This header declares the autosave journal.
+// A game is kept on disk as a snapshot (a normal V2 save) plus a journal file
+// that gets one small fixed-size record for every placement and move made
+// since that snapshot. Resuming loads the snapshot and replays the journal.
+// Now and then the journal is compacted: a new snapshot is written and the
+// journal starts again empty.
+
+#include "game.h"
+
+// The journal kept next to the snapshot (SAVE_FILE).
+#define JOURNAL_FILE "savegame.journal"
+
+// Records a journal may hold before it is compacted into a new snapshot.
+#define JOURNAL_COMPACT_EVERY 256
+
+// Record kinds.
+#define JOURNAL_PLACE 1   // a penguin was placed on the tile
+#define JOURNAL_MOVE  2   // one of the player's penguins moved to the tile
+
+// Create a journal that will write these two files. Nothing is written until
+// the first journal_snapshot. Returns NULL on failure.
+Journal *journal_create(const char *snapshot_file, const char *journal_file);
+
+// Close the journal and free it; the files stay on disk.
+void journal_free(Journal *journal);
+
+// Save the game as the new snapshot and start an empty journal for it.
+int journal_snapshot(Journal *journal, const Game *game);
+
+// Append one placement or move (player index, tile index and, for a move, the
+// direction 0-3 it went in) made after the snapshot, compacting the journal
+// when it is full.
+int journal_append(Journal *journal, const Game *game, int kind, int idx, int tile, int dir);
+
+// Records written since the latest snapshot.
+int journal_records(const Journal *journal);
+
+// Remove the snapshot and journal, once the game is over.
+void journal_discard(Journal *journal);
+
+// Load the snapshot and replay the journal written for it, up to the first
+// damaged or illegal record. Returns 0 if the snapshot cannot be loaded.
+// The number of records replayed is stored in *replayed.
+int journal_resume(const char *snapshot_file, const char *journal_file, Game *game, int *replayed);
+
+#endif
@@ -6,10 +6,27 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include "board.h"
 #include "players.h"
 #include "game.h"
+#include "search.h"
+#include "mcts.h"
+#include "endgame.h"
+#include "placement.h"
+#include "ponder.h"
+#include "render.h"
+#include "journal.h"
+#include "replay.h"
+#include "prof.h"
+
+// Transposition table size (2^bits entries) and thinking time per move for the search AI
+#define AI_TT_BITS 20
+#define AI_MOVE_MS 1000
+
+// Tree nodes per thread for the MCTS AI (a node is about 60 bytes)
+#define AI_MCTS_NODES (1 << 18)
 
 // Function to check if a save file exists
 static int save_exists(const char *filename)
@@ -21,19 +38,199 @@ static int save_exists(const char *filename)
     return 1;
 }
 
-int main(void)
+// Create the search engine with this many threads (0 = one per CPU) if any AI player uses it,
+// or if hints were asked for and a human plays; the caller frees it
+static Search *attach_search(Game *game, int threads, int hints)
+{
+    int i;
+    for (i = 0; i < game->num_players; i++)
+    {
+        if (game->players[i].is_ai == AI_SEARCH || (hints && game->players[i].is_ai == AI_NONE))
+        {
+            game->search = search_create(AI_TT_BITS);
+            if (game->search)
+            {
+                search_set_limits(game->search, SEARCH_MAX_PLY, AI_MOVE_MS);
+                search_set_threads(game->search, threads);
+            }
+            return game->search;
+        }
+    }
+    return NULL;
+}
+
+// Create the MCTS engine with this many threads (0 = one per CPU) if any AI player uses it; the caller frees it
+static Mcts *attach_mcts(Game *game, int threads)
 {
-    // Board size fixed to 10x10, num_players will be chosen by user
-    int rows = 10, cols = 10, num_players;
+    int i;
+    for (i = 0; i < game->num_players; i++)
+    {
+        if (game->players[i].is_ai == AI_MCTS)
+        {
+            game->mcts = mcts_create(threads, AI_MCTS_NODES);
+            if (game->mcts)
+                mcts_set_limits(game->mcts, AI_MOVE_MS, 0);
+            return game->mcts;
+        }
+    }
+    return NULL;
+}
+
+// Create the endgame solver if any AI player uses an engine that consults it; the caller frees it
+static Endgame *attach_endgame(Game *game)
+{
+    int i;
+    for (i = 0; i < game->num_players; i++)
+    {
+        if (game->players[i].is_ai == AI_SEARCH || game->players[i].is_ai == AI_MCTS)
+        {
+            game->endgame = endgame_create();
+            return game->endgame;
+        }
+    }
+    return NULL;
+}
+
+// Create the placement evaluator if any AI player uses an engine; the caller frees it
+static Placement *attach_placement(Game *game)
+{
+    int i;
+    for (i = 0; i < game->num_players; i++)
+    {
+        if (game->players[i].is_ai == AI_SEARCH || game->players[i].is_ai == AI_MCTS)
+        {
+            game->placement = placement_create();
+            return game->placement;
+        }
+    }
+    return NULL;
+}
+
+// Create the ponderer around the search engine if there is one and a human plays;
+// the caller frees it before the engine
+static Ponder *attach_ponder(Game *game)
+{
+    int i;
+    game->ponder = NULL;
+    for (i = 0; i < game->num_players && game->search; i++)
+    {
+        if (game->players[i].is_ai == AI_NONE)
+        {
+            game->ponder = ponder_create(game->search);
+            break;
+        }
+    }
+    return game->ponder;
+}
+
+// Read a board size written as ROWSxCOLS, each side 1..BOARD_MAX_SIDE
+static int parse_size(const char *arg, int *rows, int *cols)
+{
+    char tail;
+    return sscanf(arg, "%dx%d%c", rows, cols, &tail) == 2 &&
+           *rows >= 1 && *rows <= BOARD_MAX_SIDE && *cols >= 1 && *cols <= BOARD_MAX_SIDE;
+}
+
+// Read an unsigned 64-bit number, decimal or 0x hex, with nothing after it
+static int parse_u64(const char *arg, uint64_t *out)
+{
+    char *end;
+    if (arg[0] == '-' || arg[0] == '\0')
+        return 0;
+    *out = strtoull(arg, &end, 0);
+    return *end == '\0';
+}
+
+// Read "-b ROWSxCOLS", "-g penguins", "-s seed", "-S stream", "-T threads", "-H" and "-r file"
+// (the replay archive, opened here); returns 0 on a bad command line
+static int parse_args(int argc, char **argv, int *rows, int *cols, int *penguins, uint64_t *seed,
+                      uint64_t *stream, int *threads, int *hints, FILE **replay_out)
+{
+    const char *replay_file = NULL;
+    char tail;
+    int i;
+
+    *replay_out = NULL;
+    for (i = 1; i < argc; i++)
+    {
+        if (i + 1 < argc && strcmp(argv[i], "-b") == 0 && parse_size(argv[i + 1], rows, cols))
+            i++;
+        else if (i + 1 < argc && strcmp(argv[i], "-g") == 0 && sscanf(argv[i + 1], "%d%c", penguins, &tail) == 1 &&
+                 *penguins >= 1 && *penguins <= MAX_PENGUINS)
+            i++;
+        else if (i + 1 < argc && strcmp(argv[i], "-s") == 0 && parse_u64(argv[i + 1], seed))
+            i++;
+        else if (i + 1 < argc && strcmp(argv[i], "-S") == 0 && parse_u64(argv[i + 1], stream))
+            i++;
+        else if (i + 1 < argc && strcmp(argv[i], "-T") == 0 && sscanf(argv[i + 1], "%d%c", threads, &tail) == 1 &&
+                 *threads >= 0 && *threads <= SEARCH_MAX_THREADS && *threads <= MCTS_MAX_THREADS)
+            i++;
+        else if (strcmp(argv[i], "-H") == 0)
+            *hints = 1;
+        else if (i + 1 < argc && strcmp(argv[i], "-r") == 0)
+            replay_file = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [-b ROWSxCOLS] [-g penguins] [-s seed] [-S stream] [-T threads]\n"
+                            "          [-H] [-r replay-file]\n"
+                            "board sides are 1-%d, 10x10 by default; each player places 1-%d\n"
+                            "penguins (1); the board seed is the current time unless -s gives\n"
+                            "one, and -S picks its stream (0); the search and MCTS AIs think\n"
+                            "with -T threads (0, the default, is one per CPU); -H gives hints\n"
+                            "even when no search AI plays\n",
+                    argv[0], BOARD_MAX_SIDE, MAX_PENGUINS);
+            return 0;
+        }
+    }
+    if (!replay_file)
+        return 1;
+
+    // games are appended, so one file can collect many sessions
+    *replay_out = fopen(replay_file, "ab");
+    if (!*replay_out)
+    {
+        fprintf(stderr, "Cannot open replay file %s.\n", replay_file);
+        return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    // Board size is 10x10 unless -b gives another, num_players will be chosen by user
+    int rows = 10, cols = 10, num_players, penguins = 1, threads = 0, hints = 0;
     int mode;
+    int ai_kind = AI_GREEDY;
+    Game game;
+    Rng rng;
+    const char *save_file;
+    Journal *journal;   // autosave; the game drops its pointer if a write fails
+    FILE *replay_out;
+    Replay *replay = NULL;
+    uint64_t seed = (uint64_t)time(NULL), stream = 0;
+
+    if (!parse_args(argc, argv, &rows, &cols, &penguins, &seed, &stream, &threads, &hints, &replay_out))
+        return 1;
+    PROF_REPORT_AT_EXIT(PROF_FILE);
+    if (replay_out)
+    {
+        replay = replay_create(replay_out);
+        if (!replay)
+        {
+            printf("Memory allocation failed.\n");
+            return 1;
+        }
+    }
 
-    // Seed random number generator with current time
-    srand((unsigned int)time(NULL));
+    // Seed the board generator; the same seed and stream give the same board
+    rng_seed_stream(&rng, seed, stream);
 
     printf("=== Penguins Game ===\n");
 
     // If save file exists, ask user if they want to continue or start new game
-    if (save_exists(SAVE_FILE))
+    // (a binary save wins over an older text one)
+    save_file = save_exists(SAVE_FILE) ? SAVE_FILE : save_exists(SAVE_FILE_V1) ? SAVE_FILE_V1 : NULL;
+    if (save_file)
     {
         int choice;
         printf("A saved game was found.\n");
@@ -49,37 +246,64 @@ int main(void)
 
         if (choice == 1)
         {
-            Tile **loaded_board = NULL;
-            Player *loaded_players = NULL;
-            int *active_flags = NULL;
-            int loaded_rows = 0, loaded_cols = 0;
-            int loaded_num_players = 0;
-            int loaded_mode = 0;
-            int loaded_turn_index = 0;
-
-            // Load board, players, and movement state from saved file
-            if (!load_game(SAVE_FILE,
-                           &loaded_board, &loaded_rows, &loaded_cols,
-                           &loaded_players, &loaded_num_players,
-                           &loaded_mode, &loaded_turn_index, &active_flags))
+            Game loaded;
+            int replayed = 0;
+            int ok;
+
+            // Load board, players, and movement state from saved file,
+            // then replay the turns the autosave journal holds on top of it
+            if (strcmp(save_file, SAVE_FILE) == 0)
+                ok = journal_resume(SAVE_FILE, JOURNAL_FILE, &loaded, &replayed);
+            else
+                ok = load_game(save_file, &loaded);
+            if (!ok)
             {
                 printf("Failed to load saved game.\n");
                 return 1;
             }
+            if (replayed > 0)
+                printf("Replayed %d turn(s) from the autosave journal.\n", replayed);
 
             // Resume game from movement phase with saved turn and active player state
-            continue_game(loaded_board, loaded_rows, loaded_cols,
-                          loaded_players, loaded_num_players,
-                          loaded_mode, loaded_turn_index, active_flags);
+            attach_search(&loaded, threads, hints);
+            attach_mcts(&loaded, threads);
+            attach_endgame(&loaded);
+            attach_placement(&loaded);
+            attach_ponder(&loaded);
+            loaded.view = renderer_create();
+            if (!loaded.view)
+            {
+                printf("Memory allocation failed.\n");
+                return 1;
+            }
+            journal = journal_create(SAVE_FILE, JOURNAL_FILE);
+            loaded.journal = journal;
+            loaded.replay = replay;
+            continue_game(&loaded);
 
             // Show final scores after game ends
             printf("\n=== Final Scores ===\n");
-            print_scores(loaded_players, loaded_num_players);
+            print_scores(loaded.players, loaded.num_players);
+
+            // The game is finished, so there is nothing left to resume; a text
+            // save is this game or older than the binary one it was resumed from
+            if (journal)
+                journal_discard(journal);
+            remove(SAVE_FILE_V1);
 
             // Free all allocated memory for loaded game
-            free_board(loaded_board, loaded_rows);
-            free(loaded_players);
-            free(active_flags);
+            free_board(loaded.board);
+            free(loaded.players);
+            ponder_free(loaded.ponder);
+            search_free(loaded.search);
+            mcts_free(loaded.mcts);
+            endgame_free(loaded.endgame);
+            placement_free(loaded.placement);
+            renderer_free(loaded.view);
+            journal_free(journal);
+            replay_free(replay);
+            if (replay_out)
+                fclose(replay_out);
 
             return 0;
         }
@@ -97,23 +321,35 @@ int main(void)
         return 1;
     }
 
-    if (mode == 2)
+    if (mode == MODE_PVAI)
     {
         num_players = 2;
         printf("Player vs AI selected. Number of players set to 2.\n");
+
+        printf("Select AI engine:\n");
+        printf("1) Greedy (most fish next to it)\n");
+        printf("2) Search (alpha-beta lookahead)\n");
+        printf("3) MCTS (random playouts on every core)\n");
+        printf("Enter choice (1-3): ");
+        if (scanf("%d", &ai_kind) != 1 || ai_kind < AI_GREEDY || ai_kind > AI_MCTS)
+        {
+            printf("Invalid input.\n");
+            return 1;
+        }
     }
     else
     {
         printf("Enter number of players (2-4): ");
-        if (scanf("%d", &num_players) != 1)
+        if (scanf("%d", &num_players) != 1 || num_players < 2 || num_players > MAX_PLAYERS)
         {
             printf("Invalid input.\n");
             return 1;
         }
+        mode = MODE_PVP;
     }
 
     // Create the game board and players dynamically
-    Tile **board = create_board(rows, cols);
+    Board *board = create_board(rows, cols);
     Player *players = create_players(num_players);
 
     if (!board || !players)
@@ -123,32 +359,64 @@ int main(void)
     }
 
     // Mark AI-controlled players before initializing player names
-    if (mode == 2)
+    if (mode == MODE_PVAI)
     {
-        players[0].is_ai = 0;
-        players[1].is_ai = 1;
+        players[0].is_ai = AI_NONE;
+        players[1].is_ai = ai_kind;
     }
     else
     {
         int i;
         for (i = 0; i < num_players; i++)
-            players[i].is_ai = 0;
+            players[i].is_ai = AI_NONE;
     }
 
     // Initialize players and board for new game
-    init_players(players, num_players);
-    init_board(board, rows, cols);
+    init_players(players, num_players, penguins);
+    init_board(board, &rng);
+    printf("Board seed %llu, stream %llu.\n", (unsigned long long)seed, (unsigned long long)stream);
 
     // Start the new game play loop
-    play_game(board, rows, cols, players, num_players);
+    init_game(&game, board, players, num_players, mode);
+    attach_search(&game, threads, hints);
+    attach_mcts(&game, threads);
+    attach_endgame(&game);
+    attach_placement(&game);
+    attach_ponder(&game);
+    game.view = renderer_create();
+    if (!game.view)
+    {
+        printf("Memory allocation failed.\n");
+        return 1;
+    }
+    journal = journal_create(SAVE_FILE, JOURNAL_FILE);
+    game.journal = journal;
+    game.replay = replay;
+    game.seed = seed;
+    game.stream = stream;
+    play_game(&game);
 
     // Print final scores after game ends
     printf("\n=== Final Scores ===\n");
     print_scores(players, num_players);
 
+    // The game is finished, so there is nothing left to resume
+    if (journal)
+        journal_discard(journal);
+
     // Clean up all allocated memory before exit
-    free_board(board, rows);
+    free_board(board);
     free(players);
+    ponder_free(game.ponder);
+    search_free(game.search);
+    mcts_free(game.mcts);
+    endgame_free(game.endgame);
+    placement_free(game.placement);
+    renderer_free(game.view);
+    journal_free(journal);
+    replay_free(replay);
+    if (replay_out)
+        fclose(replay_out);
 
     return 0;
 }
\ No newline at end of file
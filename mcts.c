@@ -0,0 +1,412 @@
+/* This file implements the Monte Carlo Tree Search AI declared in mcts.h.
+   Every playout walks down the thread's tree by UCT on the thread's own
+   working board, adds the children of the node it stops at, then finishes the
+   game with fish-weighted random moves. The winner (ties share the point) is
+   credited along the path, and every move of the playout is taken back with
+   unmake_move so the board is back at the root for the next one. Almost
+   nothing is allocated while a move is being searched: tree nodes come from
+   a fixed-size pool per thread, boards are reused from move to move, and a
+   thread's path of moves only grows when a playout outlasts every earlier one. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "mcts.h"
+#include "rng.h"
+
+// Exploration constant of the UCT formula (rewards are in [0, 1]).
+#define UCT_C 0.7
+
+// Moves a thread's path first has room for; it doubles when a playout needs more.
+#define PATH_START 256
+
+// One position in a thread's tree.
+typedef struct {
+    int parent;                  // index of the parent, -1 for the root
+    int first_child;             // index of the first child, -1 until expanded
+    int num_children;
+    int mover;                   // player to move here, 0 if nobody can, -1 until first reached
+    Move move;                   // move that led here from the parent
+    int visits;
+    float reward[MAX_PLAYERS];   // summed playout rewards, by player id - 1
+} Node;
+
+// Everything one thread owns during a decision.
+typedef struct {
+    struct Mcts *mcts;
+    int id;
+    Node *nodes;                 // pool of mcts->node_capacity nodes
+    int used;
+    Board *board;                // working copy, reused by every playout
+    MoveDelta *path;             // moves of the current playout, kept between decisions
+    int path_cap;
+    int depth;
+    int scores[MAX_PLAYERS];
+    Rng rng;
+    long playouts;
+} MctsWorker;
+
+struct Mcts {
+    MctsWorker workers[MCTS_MAX_THREADS];
+    int num_threads;
+    int node_capacity;
+    int time_ms;
+    int max_playouts;
+    int rows, cols;              // size the working boards were made for
+
+    // the decision in progress, read-only for the workers
+    const Board *root_board;
+    int root_scores[MAX_PLAYERS];
+    int num_players;
+    int root_player;
+    double deadline;
+    uint64_t seed;               // playouts from the same position replay the same random games
+
+    MctsStats last;
+    MctsStats total;
+};
+
+// Seconds on a monotonic clock
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Create the player and every thread's node pool
+Mcts *mcts_create(int threads, int node_capacity)
+{
+    Mcts *mcts;
+    int i;
+
+    if (threads <= 0)
+    {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = n > 0 ? (int)n : 1;
+    }
+    if (threads > MCTS_MAX_THREADS) threads = MCTS_MAX_THREADS;
+    if (node_capacity < 64) node_capacity = 64;
+
+    mcts = calloc(1, sizeof(Mcts));
+    if (!mcts) return NULL;
+
+    mcts->num_threads = threads;
+    mcts->node_capacity = node_capacity;
+    mcts->time_ms = 1000;
+    for (i = 0; i < threads; i++)
+    {
+        mcts->workers[i].mcts = mcts;
+        mcts->workers[i].id = i;
+        mcts->workers[i].nodes = malloc((size_t)node_capacity * sizeof(Node));
+        if (!mcts->workers[i].nodes)
+        {
+            mcts_free(mcts);
+            return NULL;
+        }
+    }
+    return mcts;
+}
+
+// Free node pools, working boards and the player
+void mcts_free(Mcts *mcts)
+{
+    int i;
+    if (!mcts) return;
+    for (i = 0; i < mcts->num_threads; i++)
+    {
+        free(mcts->workers[i].nodes);
+        free_board(mcts->workers[i].board);
+        free(mcts->workers[i].path);
+    }
+    free(mcts);
+}
+
+// Set the per-move budget
+void mcts_set_limits(Mcts *mcts, int time_ms, int max_playouts)
+{
+    mcts->time_ms = time_ms > 0 ? time_ms : 0;
+    mcts->max_playouts = max_playouts > 0 ? max_playouts : 0;
+    if (!mcts->time_ms && !mcts->max_playouts)
+        mcts->time_ms = 1000;
+}
+
+// Make sure every thread has a working board of this size
+static int ensure_boards(Mcts *mcts, const Board *board)
+{
+    int i;
+    if (mcts->workers[0].board && mcts->rows == board->rows && mcts->cols == board->cols)
+        return 1;
+
+    for (i = 0; i < mcts->num_threads; i++)
+    {
+        free_board(mcts->workers[i].board);
+        mcts->workers[i].board = create_board(board->rows, board->cols);
+        if (!mcts->workers[i].board)
+            return 0;
+    }
+    mcts->rows = board->rows;
+    mcts->cols = board->cols;
+    return 1;
+}
+
+// Double the room for the playout's moves
+static int grow_path(MctsWorker *w)
+{
+    int cap = w->path_cap ? w->path_cap * 2 : PATH_START;
+    MoveDelta *grown = realloc(w->path, (size_t)cap * sizeof(MoveDelta));
+    if (!grown) return 0;
+    w->path = grown;
+    w->path_cap = cap;
+    return 1;
+}
+
+// Move a penguin on the working board, credit the fish and remember the move.
+// Returns 0 if the path is full and cannot grow.
+static int play(MctsWorker *w, const Move *m, int p)
+{
+    if (w->depth == w->path_cap && !grow_path(w))
+        return 0;
+    w->scores[p - 1] += make_move(w->board, p, m->from, m->to, &w->path[w->depth++]);
+    return 1;
+}
+
+// Pick the child with the best UCT value for the player moving at the parent
+static int select_child(const MctsWorker *w, int parent)
+{
+    const Node *pn = &w->nodes[parent];
+    double log_n = log((double)pn->visits + 1);
+    double best = -1;
+    int i, best_child = pn->first_child;
+
+    for (i = 0; i < pn->num_children; i++)
+    {
+        const Node *c = &w->nodes[pn->first_child + i];
+        double v;
+        if (c->visits == 0)
+            return pn->first_child + i;
+
+        v = c->reward[pn->mover - 1] / c->visits + UCT_C * sqrt(log_n / c->visits);
+        if (v > best)
+        {
+            best = v;
+            best_child = pn->first_child + i;
+        }
+    }
+    return best_child;
+}
+
+// Add one child per legal move of the player to move. Returns 0 if the pool is full.
+static int expand(MctsWorker *w, int node)
+{
+    Node *nd = &w->nodes[node];
+    Move moves[MAX_MOVES];
+    int n = board_gen_moves(w->board, nd->mover, moves);
+    int i;
+
+    if (w->used + n > w->mcts->node_capacity)
+        return 0;
+
+    nd->first_child = w->used;
+    nd->num_children = n;
+    for (i = 0; i < n; i++)
+    {
+        Node *c = &w->nodes[w->used++];
+        memset(c, 0, sizeof(*c));
+        c->parent = node;
+        c->first_child = -1;
+        c->mover = -1;
+        c->move = moves[i];
+    }
+    return 1;
+}
+
+// Finish the game from the working board with random moves, favouring tiles with more fish;
+// the playout ends early if its path cannot grow
+static void rollout(MctsWorker *w, int p)
+{
+    int n = w->mcts->num_players;
+    Move moves[MAX_MOVES];
+
+    while (p)
+    {
+        int k = board_gen_moves(w->board, p, moves);
+        int i, total = 0, pick;
+
+        for (i = 0; i < k; i++)
+            total += moves[i].fish + 1;
+        pick = rng_below(&w->rng, total);
+        for (i = 0; pick >= moves[i].fish + 1; i++)
+            pick -= moves[i].fish + 1;
+
+        if (!play(w, &moves[i], p))
+            break;
+        p = board_next_mover(w->board, n, p % n + 1);
+    }
+}
+
+// One playout: select, expand, roll out, and credit the winner back up the path
+static void playout(MctsWorker *w)
+{
+    Mcts *mcts = w->mcts;
+    int n = mcts->num_players;
+    float reward[MAX_PLAYERS];
+    int node = 0, i, best = -1, winners = 0;
+
+    memcpy(w->scores, mcts->root_scores, sizeof(w->scores));
+
+    // selection and expansion
+    while (w->nodes[node].mover > 0)
+    {
+        Node *nd = &w->nodes[node];
+        int child;
+
+        if (nd->first_child < 0)
+        {
+            // a leaf is expanded on its second visit; the root right away
+            if ((node != 0 && nd->visits == 0) || !expand(w, node))
+                break;
+        }
+
+        child = select_child(w, node);
+        if (!play(w, &w->nodes[child].move, nd->mover))
+            break;
+        if (w->nodes[child].mover < 0)
+            w->nodes[child].mover = board_next_mover(w->board, n, nd->mover % n + 1);
+        node = child;
+    }
+
+    rollout(w, w->nodes[node].mover);
+
+    // reward: 1 for the winner, shared equally on a tie
+    for (i = 0; i < n; i++)
+    {
+        if (w->scores[i] > best) { best = w->scores[i]; winners = 1; }
+        else if (w->scores[i] == best) winners++;
+    }
+    for (i = 0; i < n; i++)
+        reward[i] = w->scores[i] == best ? 1.0f / winners : 0.0f;
+
+    for (; node >= 0; node = w->nodes[node].parent)
+    {
+        w->nodes[node].visits++;
+        for (i = 0; i < n; i++)
+            w->nodes[node].reward[i] += reward[i];
+    }
+
+    // back to the root position for the next playout
+    while (w->depth > 0)
+        unmake_move(w->board, &w->path[--w->depth]);
+    w->playouts++;
+}
+
+// Thread body: grow this thread's tree until the budget is used up
+static void *worker_run(void *arg)
+{
+    MctsWorker *w = (MctsWorker *)arg;
+    Mcts *mcts = w->mcts;
+    Node *root = &w->nodes[0];
+
+    memset(root, 0, sizeof(*root));
+    root->parent = -1;
+    root->first_child = -1;
+    root->mover = mcts->root_player;
+    w->used = 1;
+    w->playouts = 0;
+    w->depth = 0;
+    board_copy(w->board, mcts->root_board);
+    rng_seed(&w->rng, mcts->seed + (uint64_t)w->id * 0x9E3779B97F4A7C15ULL);
+
+    while (1)
+    {
+        if (mcts->max_playouts && w->playouts >= mcts->max_playouts)
+            break;
+        if (mcts->time_ms && (w->playouts & 15) == 0 && now_seconds() > mcts->deadline)
+            break;
+        playout(w);
+    }
+    return NULL;
+}
+
+// Run all threads from the current position and pick the root move visited most in total
+int mcts_best_move(Mcts *mcts, const Board *board, const int *scores, int num_players, int player_id,
+                   Move *move)
+{
+    pthread_t threads[MCTS_MAX_THREADS];
+    int started[MCTS_MAX_THREADS];
+    long visits[MAX_MOVES] = { 0 };
+    Move moves[MAX_MOVES];
+    double start = now_seconds();
+    int n, i, k, best = 0, used_threads = 1;
+
+    n = board_gen_moves(board, player_id, moves);
+    if (n == 0 || !ensure_boards(mcts, board))
+        return 0;
+
+    mcts->root_board = board;
+    memset(mcts->root_scores, 0, sizeof(mcts->root_scores));
+    memcpy(mcts->root_scores, scores, num_players * sizeof(int));
+    mcts->num_players = num_players;
+    mcts->root_player = player_id;
+    mcts->deadline = start + mcts->time_ms / 1000.0;
+    mcts->seed = board->hash ^ (uint64_t)player_id;
+
+    if (n > 1)
+    {
+        for (i = 1; i < mcts->num_threads; i++)
+        {
+            started[i] = pthread_create(&threads[i], NULL, worker_run, &mcts->workers[i]) == 0;
+            used_threads += started[i];
+        }
+        worker_run(&mcts->workers[0]);
+        for (i = 1; i < mcts->num_threads; i++)
+            if (started[i])
+                pthread_join(threads[i], NULL);
+
+        // every tree lists the root moves in the same order as moves[]
+        for (i = 0; i < mcts->num_threads; i++)
+        {
+            const MctsWorker *w = &mcts->workers[i];
+            if (i > 0 && !started[i]) continue;
+            for (k = 0; k < w->nodes[0].num_children; k++)
+                visits[k] += w->nodes[w->nodes[0].first_child + k].visits;
+        }
+        for (k = 1; k < n; k++)
+            if (visits[k] > visits[best]) best = k;
+    }
+
+    memset(&mcts->last, 0, sizeof(mcts->last));
+    mcts->last.threads = used_threads;
+    for (i = 0; i < mcts->num_threads && n > 1; i++)
+    {
+        if (i > 0 && !started[i]) continue;
+        mcts->last.playouts += mcts->workers[i].playouts;
+        mcts->last.nodes += mcts->workers[i].used;
+    }
+    mcts->last.seconds = now_seconds() - start;
+
+    mcts->total.playouts += mcts->last.playouts;
+    mcts->total.nodes += mcts->last.nodes;
+    mcts->total.seconds += mcts->last.seconds;
+    mcts->total.searches++;
+
+    if (move) *move = moves[best];
+    return 1;
+}
+
+// Statistics of the latest decision
+const MctsStats *mcts_last_stats(const Mcts *mcts)
+{
+    return &mcts->last;
+}
+
+// Statistics of all decisions so far
+const MctsStats *mcts_total_stats(const Mcts *mcts)
+{
+    return &mcts->total;
+}
@@ -0,0 +1,47 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+// This header declares the Monte Carlo Tree Search AI (UCT).
+// Each move runs playouts until a wall-clock budget or playout limit is
+// reached. With several threads every thread grows its own tree from the
+// current position (root parallelism) and the root visit counts are summed
+// at the end, so threads never share a tree or a board.
+
+#include "board.h"
+
+// Highest number of threads one MCTS player uses.
+#define MCTS_MAX_THREADS 64
+
+// Counters of one move decision, or summed over many.
+typedef struct {
+    long playouts;    // complete random games played from the tree
+    long nodes;       // tree nodes created
+    long searches;    // moves chosen (totals only)
+    int threads;      // threads used (last decision only)
+    double seconds;   // wall-clock time spent
+} MctsStats;
+
+typedef struct Mcts Mcts;
+
+// Create an MCTS player with room for node_capacity tree nodes per thread.
+// threads = 0 uses one thread per CPU. Returns NULL on failure.
+Mcts *mcts_create(int threads, int node_capacity);
+
+// Free the player, its threads' trees and boards.
+void mcts_free(Mcts *mcts);
+
+// Stop after time_ms milliseconds or max_playouts playouts per thread, whichever comes first (0 = no limit; not both).
+void mcts_set_limits(Mcts *mcts, int time_ms, int max_playouts);
+
+// Choose a move for player_id. scores[i] is the current score of player id i + 1.
+// Returns 1 and the move (which penguin, and where to) if the player can move, 0 otherwise.
+int mcts_best_move(Mcts *mcts, const Board *board, const int *scores, int num_players, int player_id,
+                   Move *move);
+
+// Statistics of the most recent decision.
+const MctsStats *mcts_last_stats(const Mcts *mcts);
+
+// Statistics summed over every decision since the player was created.
+const MctsStats *mcts_total_stats(const Mcts *mcts);
+
+#endif
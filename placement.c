@@ -0,0 +1,479 @@
+/* This file implements the placement evaluator declared in placement.h.
+   One call makes three passes over the board:
+     1. a breadth-first search from every penguin at once, over free ice and
+        at most PLACEMENT_RADIUS steps deep, giving each tile its distance to
+        the nearest penguin (near[], PLACEMENT_RADIUS + 1 when out of reach)
+     2. a union-find labelling of the ice, row by row, then the fish of every
+        region, counting the tile under each penguin as the 1 fish it held
+        before the penguin was placed there; this is skipped while the
+        board's unplaced key (board_unplaced_key) matches the one last
+        labelled, so a placement phase labels the board once
+     3. a sweep that keeps a summed-area table of fish * near[] for the last
+        2 * PLACEMENT_RADIUS + 2 rows only and scores each free 1-fish tile,
+        found through the bit planes, from four of its entries and its region
+   All buffers belong to the evaluator and only grow. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "placement.h"
+#include "prof.h"
+
+#ifdef BOARD_VERIFY
+#include <assert.h>
+#endif
+
+#define RADIUS PLACEMENT_RADIUS
+#define FAR    (PLACEMENT_RADIUS + 1)
+
+// Rows of the summed-area ring: both edges of a window 2R+1 rows tall
+#define RING_ROWS (2 * PLACEMENT_RADIUS + 2)
+
+// Most tiles the search can reach: every penguin's diamond of radius R
+#define QUEUE_TILES (MAX_PLAYERS * MAX_PENGUINS * (2 * PLACEMENT_RADIUS * (PLACEMENT_RADIUS + 1) + 1))
+
+// Region fish per penguin past which more space no longer helps: a full window of tiles
+#define SHARE_CAP ((2 * PLACEMENT_RADIUS + 1) * (2 * PLACEMENT_RADIUS + 1))
+
+// Fish and penguins of one region of ice
+typedef struct {
+    int fish;       // with a fish under every penguin, taken off while a call runs
+    int penguins;   // only counted while a call runs
+} Region;
+
+struct Placement {
+    int *label;             // per tile: union-find parent, then -(region + 1) at roots
+    unsigned char *near;    // per tile: steps to the nearest penguin, capped at FAR
+    uint32_t *ring;         // RING_ROWS rows of cols + 1 summed-area entries
+    Region *regions;
+    uint64_t key;           // unplaced key of the board the labels were made for
+    int rows, cols;         // its size, 0 when there are no labels
+    size_t tiles_cap, ring_cap, regions_cap;
+    int queue[QUEUE_TILES];
+};
+
+// Free ice nobody stands on: no owner bits and 1-3 fish, i.e. a tile byte of 1, 2 or 3
+static int is_free(Tile t)
+{
+    return (Tile)(t - 1) < 3;
+}
+
+// Create an evaluator with empty buffers
+Placement *placement_create(void)
+{
+    return calloc(1, sizeof(Placement));
+}
+
+// Free the evaluator and its buffers
+void placement_free(Placement *placement)
+{
+    if (!placement) return;
+    free(placement->label);
+    free(placement->near);
+    free(placement->ring);
+    free(placement->regions);
+    free(placement);
+}
+
+// Grow the per-tile buffers and the ring to fit the board
+static int reserve(Placement *pl, const Board *board)
+{
+    size_t tiles = (size_t)board->rows * board->cols;
+    size_t ring = (size_t)RING_ROWS * (board->cols + 1);
+
+    if (tiles > pl->tiles_cap)
+    {
+        int *label = realloc(pl->label, tiles * sizeof(int));
+        unsigned char *near;
+        if (!label) return 0;
+        pl->label = label;
+        near = realloc(pl->near, tiles);
+        if (!near) return 0;
+        pl->near = near;
+        pl->tiles_cap = tiles;
+    }
+    if (ring > pl->ring_cap)
+    {
+        uint32_t *r = realloc(pl->ring, ring * sizeof(uint32_t));
+        if (!r) return 0;
+        pl->ring = r;
+        pl->ring_cap = ring;
+    }
+    return 1;
+}
+
+// Pass 1: distance from every free tile to the nearest penguin, searched from all penguins at once
+static void spread_penguins(Placement *pl, const Board *board)
+{
+    int rows = board->rows, cols = board->cols;
+    int head = 0, tail = 0, owner, k;
+
+    memset(pl->near, FAR, (size_t)rows * cols);
+    for (owner = 1; owner <= MAX_PLAYERS; owner++)
+    {
+        for (k = 0; k < board->num_penguins[owner]; k++)
+        {
+            pl->near[board->penguins[owner][k]] = 0;
+            pl->queue[tail++] = board->penguins[owner][k];
+        }
+    }
+
+    while (head < tail)
+    {
+        int t = pl->queue[head++];
+        int r = t / cols, c = t % cols;
+        int around[4], n = 0, d = pl->near[t] + 1;
+
+        if (d > RADIUS)
+            continue;
+        if (r > 0)        around[n++] = t - cols;
+        if (r < rows - 1) around[n++] = t + cols;
+        if (c > 0)        around[n++] = t - 1;
+        if (c < cols - 1) around[n++] = t + 1;
+        for (k = 0; k < n; k++)
+        {
+            if (pl->near[around[k]] <= d || !is_free(board->tiles[around[k]]))
+                continue;
+            pl->near[around[k]] = (unsigned char)d;
+            pl->queue[tail++] = around[k];
+        }
+    }
+}
+
+// Root of tile t's set, halving the path on the way
+static int find_root(int *label, int t)
+{
+    while (label[t] >= 0 && label[t] != t)
+    {
+        if (label[label[t]] >= 0)
+            label[t] = label[label[t]];
+        t = label[t];
+    }
+    return t;
+}
+
+// Join the sets of tiles a and b under the lower root, so a root always comes first in row order
+static void join(int *label, int a, int b)
+{
+    a = find_root(label, a);
+    b = find_root(label, b);
+    if (a < b) label[b] = a;
+    else if (b < a) label[a] = b;
+}
+
+// Region index of ice tile t once the labels are made
+static int region_of(const int *label, int t)
+{
+    int root = label[t] < 0 ? t : label[t];
+    return -label[root] - 1;
+}
+
+// Pass 2: label the regions of ice and count their fish, unless only
+// penguins were placed since the last call. Returns 0 if the region table cannot grow.
+static int label_regions(Placement *pl, const Board *board)
+{
+    int rows = board->rows, cols = board->cols;
+    const Tile *tiles = board->tiles;
+    int *label = pl->label;
+    uint64_t key = board_unplaced_key(board);
+    int r, c, t, n = 0;
+
+    if (pl->rows == rows && pl->cols == cols && pl->key == key)
+        return 1;
+    pl->rows = 0;
+
+    // a tile joins the set of its left or upper neighbour; the two sets only
+    // need joining when the tile between them (up-left) is water
+    for (r = 0, t = 0; r < rows; r++)
+    {
+        for (c = 0; c < cols; c++, t++)
+        {
+            int left, up;
+            if (!tiles[t])
+                continue;
+            left = c > 0 && tiles[t - 1];
+            up = r > 0 && tiles[t - cols];
+            label[t] = left ? label[t - 1] : up ? label[t - cols] : t;
+            if (left && up && !tiles[t - cols - 1])
+                join(label, t - 1, t - cols);
+        }
+    }
+
+    // number the roots in row order and point every other tile straight at its root
+    for (t = 0; t < rows * cols; t++)
+    {
+        int root;
+        if (!tiles[t])
+            continue;
+        root = find_root(label, t);
+        if (label[root] == root)
+        {
+            if ((size_t)n == pl->regions_cap)
+            {
+                size_t cap = pl->regions_cap ? pl->regions_cap * 2 : 64;
+                Region *grown = realloc(pl->regions, cap * sizeof(Region));
+                if (!grown) return 0;
+                pl->regions = grown;
+                pl->regions_cap = cap;
+            }
+            pl->regions[n].fish = 0;
+            pl->regions[n].penguins = 0;
+            label[root] = -(n++) - 1;
+        }
+        if (t != root)
+            label[t] = root;
+        pl->regions[region_of(label, t)].fish += tile_owner(tiles[t]) ? 1 : tile_fish(tiles[t]);
+    }
+
+    pl->key = key;
+    pl->rows = rows;
+    pl->cols = cols;
+    return 1;
+}
+
+// Count every penguin into the region it stands in (delta 1), taking off the
+// fish its tile was labelled with, or put the regions back (delta -1)
+static void count_penguins(Placement *pl, const Board *board, int delta)
+{
+    int owner, k;
+    for (owner = 1; owner <= MAX_PLAYERS; owner++)
+    {
+        for (k = 0; k < board->num_penguins[owner]; k++)
+        {
+            Region *region = &pl->regions[region_of(pl->label, board->penguins[owner][k])];
+            region->penguins += delta;
+            region->fish -= delta;
+        }
+    }
+}
+
+// Summed-area row y (fish * near over free tiles of rows 0..y-1) from row y - 1 and tile row y - 1
+static void sum_row(Placement *pl, const Board *board, int y)
+{
+    int cols = board->cols, c;
+    uint32_t *row = pl->ring + (size_t)(y % RING_ROWS) * (cols + 1);
+    const uint32_t *above = pl->ring + (size_t)((y + RING_ROWS - 1) % RING_ROWS) * (cols + 1);
+    const Tile *tiles = board->tiles + (size_t)(y - 1) * cols;
+    const unsigned char *near = pl->near + (size_t)(y - 1) * cols;
+    uint32_t run = 0;
+
+    row[0] = 0;
+    for (c = 0; c < cols; c++)
+    {
+        // a free tile's byte is its fish count, anything else counts 0
+        uint32_t fish = is_free(tiles[c]) ? tiles[c] : 0;
+        run += fish * near[c];
+        row[c + 1] = above[c + 1] + run;
+    }
+}
+
+// Score of the free 1-fish tile (r, c), given the summed-area rows at the window's edges
+static long score_tile(const Placement *pl, const Board *board, int r, int c,
+                       const uint32_t *lo, const uint32_t *hi)
+{
+    int left = c - RADIUS < 0 ? 0 : c - RADIUS;
+    int right = c + RADIUS + 1 > board->cols ? board->cols : c + RADIUS + 1;
+    const Region *region;
+    long share;
+
+    // stuck at once: only worth taking when nothing else is left
+    if (!board_move_mask(board, r, c))
+        return 0;
+    region = &pl->regions[region_of(pl->label, r * board->cols + c)];
+    share = region->fish / (region->penguins + 1);
+    if (share > SHARE_CAP) share = SHARE_CAP;
+    return (long)(hi[right] - hi[left] - lo[right] + lo[left]) + FAR * share;
+}
+
+#ifdef BOARD_VERIFY
+// Largest board (tiles) a -DBOARD_VERIFY build scores again from scratch
+#define VERIFY_TILES 400
+
+// Neighbours of tile t on the board; returns how many
+static int verify_around(const Board *board, int t, int *around)
+{
+    int r = t / board->cols, c = t % board->cols, n = 0;
+    if (r > 0)                around[n++] = t - board->cols;
+    if (r < board->rows - 1)  around[n++] = t + board->cols;
+    if (c > 0)                around[n++] = t - 1;
+    if (c < board->cols - 1)  around[n++] = t + 1;
+    return n;
+}
+
+// Reference check of a choice: one breadth-first search per penguin for the
+// distances, then for every candidate the window summed tile by tile and its
+// region flood filled; the best score and the first tile with it must match
+static void verify_choice(const Board *board, int got, long got_score)
+{
+    int tiles = board->rows * board->cols;
+    int *near, *dist, *queue;
+    int t, u, k, owner, best_t = -1;
+    long best = -1;
+
+    if (tiles > VERIFY_TILES)
+        return;
+    near = malloc(tiles * sizeof(int));
+    dist = malloc(tiles * sizeof(int));
+    queue = malloc(tiles * sizeof(int));
+    if (!near || !dist || !queue)
+    {
+        free(near);
+        free(dist);
+        free(queue);
+        return;
+    }
+
+    for (t = 0; t < tiles; t++)
+        near[t] = FAR;
+    for (owner = 1; owner <= MAX_PLAYERS; owner++)
+    {
+        for (k = 0; k < board->num_penguins[owner]; k++)
+        {
+            int head = 0, tail = 0;
+            for (t = 0; t < tiles; t++)
+                dist[t] = -1;
+            dist[board->penguins[owner][k]] = 0;
+            queue[tail++] = board->penguins[owner][k];
+            while (head < tail)
+            {
+                int around[4], n;
+                u = queue[head++];
+                n = verify_around(board, u, around);
+                while (n--)
+                {
+                    if (dist[around[n]] < 0 && is_free(board->tiles[around[n]]))
+                    {
+                        dist[around[n]] = dist[u] + 1;
+                        queue[tail++] = around[n];
+                    }
+                }
+            }
+            for (t = 0; t < tiles; t++)
+                if (dist[t] >= 0 && dist[t] < near[t])
+                    near[t] = dist[t];
+        }
+    }
+
+    for (t = 0; t < tiles; t++)
+    {
+        int r = t / board->cols, c = t % board->cols, rr, cc, around[4], n, head = 0, tail = 0;
+        long score = 0, fish = 0, penguins = 0, share;
+
+        if (tile_fish(board->tiles[t]) != 1 || tile_owner(board->tiles[t]))
+            continue;
+        n = verify_around(board, t, around);
+        while (n > 0 && !is_free(board->tiles[around[n - 1]]))
+            n--;
+        if (n > 0)
+        {
+            for (rr = r - RADIUS; rr <= r + RADIUS; rr++)
+                for (cc = c - RADIUS; cc <= c + RADIUS; cc++)
+                    if (rr >= 0 && rr < board->rows && cc >= 0 && cc < board->cols &&
+                        is_free(board->tiles[rr * board->cols + cc]))
+                        score += tile_fish(board->tiles[rr * board->cols + cc]) * near[rr * board->cols + cc];
+
+            // the region: every ice tile joined to t, penguins' tiles included
+            for (u = 0; u < tiles; u++)
+                dist[u] = 0;
+            dist[t] = 1;
+            queue[tail++] = t;
+            while (head < tail)
+            {
+                u = queue[head++];
+                if (tile_owner(board->tiles[u]))
+                    penguins++;
+                else
+                    fish += tile_fish(board->tiles[u]);
+                n = verify_around(board, u, around);
+                while (n--)
+                {
+                    if (!dist[around[n]] && board->tiles[around[n]])
+                    {
+                        dist[around[n]] = 1;
+                        queue[tail++] = around[n];
+                    }
+                }
+            }
+            share = fish / (penguins + 1);
+            if (share > SHARE_CAP) share = SHARE_CAP;
+            score += FAR * share;
+        }
+        if (score > best)
+        {
+            best = score;
+            best_t = t;
+        }
+    }
+    assert(best == got_score && best_t == got);
+
+    free(near);
+    free(dist);
+    free(queue);
+}
+#endif
+
+// Score every free 1-fish tile and pick the best; the first in row order wins ties
+int placement_choose(Placement *pl, const Board *board, int *out_r, int *out_c)
+{
+    const Bitboard *bb = &board->bits;
+    int rows = board->rows, cols = board->cols;
+    int r, y = 0, best_r = -1, best_c = -1;
+    long best = -1;
+
+    if (board->placeable == 0)
+        return 0;
+    if (!reserve(pl, board) || !label_regions(pl, board))
+    {
+        pl->rows = 0;
+        return find_first_placement(board, out_r, out_c);
+    }
+    spread_penguins(pl, board);
+    count_penguins(pl, board, 1);
+    PROF_SCAN(PROF_SCAN_PLACEMENT_EVAL, 2L * rows * cols);
+
+    memset(pl->ring, 0, (size_t)(cols + 1) * sizeof(uint32_t));
+    for (r = 0; r < rows; r++)
+    {
+        int top = r - RADIUS < 0 ? 0 : r - RADIUS;
+        int bottom = r + RADIUS + 1 > rows ? rows : r + RADIUS + 1;
+        int base = bitboard_index(bb, r, 0), end = base + cols, i = base;
+        const uint32_t *lo, *hi;
+
+        while (y < bottom)
+            sum_row(pl, board, ++y);
+        lo = pl->ring + (size_t)(top % RING_ROWS) * (cols + 1);
+        hi = pl->ring + (size_t)(bottom % RING_ROWS) * (cols + 1);
+
+        // walk the row's free 1-fish tiles a plane word at a time
+        while (i < end)
+        {
+            uint64_t w = (bb->one_fish[i >> 6] & ~bb->occupied[i >> 6]) >> (i & 63);
+            long score;
+
+            if (!w)
+            {
+                i = (i | 63) + 1;
+                continue;
+            }
+            i += __builtin_ctzll(w);
+            if (i >= end)
+                break;
+            score = score_tile(pl, board, r, i - base, lo, hi);
+            if (score > best)
+            {
+                best = score;
+                best_r = r;
+                best_c = i - base;
+            }
+            i++;
+        }
+    }
+    count_penguins(pl, board, -1);
+#ifdef BOARD_VERIFY
+    verify_choice(board, best_r * cols + best_c, best);
+#endif
+
+    if (out_r) *out_r = best_r;
+    if (out_c) *out_c = best_c;
+    return 1;
+}
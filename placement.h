@@ -0,0 +1,42 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+// This header declares the placement evaluator.
+// Where a penguin starts decides most of the game, so instead of the first
+// free 1-fish tile the evaluator scores every one of them by the fish it can
+// hope to collect:
+//   - fish near the tile, each worth more the farther it lies (walking over
+//     free ice) from every penguin already placed, so crowded corners lose
+//     value; this is a Voronoi split of the ice cut off at PLACEMENT_RADIUS
+//   - the fish of the ice region the tile belongs to, shared with the
+//     penguins already in it, so a small pocket behind water scores little
+//     however rich its few tiles are
+// A tile with no free neighbour is never picked while another is left.
+// Each call makes a fixed number of passes over the board (one breadth-first
+// search from all penguins at once, one union-find labelling of the regions
+// and one summed-area sweep that scores every candidate in O(1)), never a
+// flood fill per candidate, so the cost stays linear in the board's area.
+
+#include "board.h"
+
+// Steps over free ice within which a penguin makes fish less worth having.
+// The fish counted around a candidate are the (2R+1) x (2R+1) square around it.
+#define PLACEMENT_RADIUS 3
+
+typedef struct Placement Placement;
+
+// Create an evaluator. Its buffers grow to the largest board it has scored
+// and are kept for the next call. Returns NULL on failure.
+Placement *placement_create(void);
+
+// Free the evaluator and its buffers.
+void placement_free(Placement *placement);
+
+// Find the best tile for the next penguin. Every penguin on the board counts
+// as a rival, the player's own included: a second penguin next to the first
+// only splits the same fish. Returns 1 with its row and column, 0 if no tile
+// can take a penguin. If the buffers cannot grow it falls back to
+// find_first_placement.
+int placement_choose(Placement *placement, const Board *board, int *out_r, int *out_c);
+
+#endif
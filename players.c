@@ -30,18 +30,28 @@ Player *create_players(int num_players)
     return malloc(num_players * sizeof(Player));
 }
 
-// This function initializes player data (id, score, penguins) and handles human vs AI name setup.
-void init_players(Player *players, int num_players)
+// This function resets player data (id, score, penguins) for a new game without printing anything.
+void reset_players(Player *players, int num_players, int penguins)
 {
-    // Initialize each player one by one.
     int i;
-
     for (i = 0; i < num_players; i++)
     {
         players[i].id = i + 1;
-        players[i].left = 1;
+        players[i].left = penguins;
         players[i].score = 0;
+    }
+}
 
+// This function initializes player data (id, score, penguins) and handles human vs AI name setup.
+void init_players(Player *players, int num_players, int penguins)
+{
+    // Initialize each player one by one.
+    int i;
+
+    reset_players(players, num_players, penguins);
+
+    for (i = 0; i < num_players; i++)
+    {
         if (players[i].is_ai)
         {
             snprintf(players[i].name, sizeof(players[i].name), "AI");
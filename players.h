@@ -3,11 +3,17 @@
 
 // This header defines the Player structure and player-related function declarations.
 
+// Values of Player.is_ai: 0 is a human, anything else names the AI engine.
+#define AI_NONE   0   // human player
+#define AI_GREEDY 1   // one-ply greedy: adjacent tile with the most fish
+#define AI_SEARCH 2   // alpha-beta search (search.c)
+#define AI_MCTS   3   // Monte Carlo Tree Search (mcts.c)
+
 // This struct represents a player in the game.
 typedef struct {
     char name[32];   // player name
     int id;          // unique player identifier
-    int is_ai;       // whether the player is controlled by AI
+    int is_ai;       // AI engine controlling the player (AI_*), 0 for a human
     int left;        // number of penguins left to place
     int score;       // total collected fish
 } Player;
@@ -15,8 +21,11 @@ typedef struct {
 // This function allocates memory for all players.
 Player *create_players(int num_players);
 
-// This function initializes player data and names.
-void init_players(Player *players, int num_players);
+// This function initializes player data and names; every player gets penguins to place.
+void init_players(Player *players, int num_players, int penguins);
+
+// This function resets ids, scores and penguins to place without any terminal I/O.
+void reset_players(Player *players, int num_players, int penguins);
 
 // This function prints the scoreboard.
 void print_scores(Player *players, int num_players);
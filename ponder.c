@@ -0,0 +1,242 @@
+/* This file implements the ponderer declared in ponder.h.
+   ponder_start copies the board and starts one thread (the search may add
+   its own helpers). The thread searches the hint, hands it over under a
+   mutex so a waiting ponder_hint wakes up, then plays each of the human's
+   moves on its copy, searches the reply and takes the move back. Replies are
+   kept by board hash and the player to move; they are only read after
+   ponder_stop has joined the thread, so they need no lock. ponder_stop
+   raises both the ponderer's stop flag and the search's, so a search in
+   progress returns within a few thousand nodes and its result is dropped. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "ponder.h"
+
+// States of the hint.
+#define HINT_NONE    0   // no hint: not thinking, or the search was stopped or found no move
+#define HINT_PENDING 1   // the thread is still searching it
+#define HINT_READY   2
+
+// One pondered reply.
+typedef struct {
+    uint64_t key;      // board hash after the human's move
+    int player;        // player whose reply it is
+    Move move;
+    int depth;
+} Reply;
+
+struct Ponder {
+    Search *search;                  // borrowed from the caller
+    Board *board;                    // the thread's copy of the board
+    int num_players;
+    int human;                       // id of the player whose turn is thought about
+    int is_ai[MAX_PLAYERS + 1];      // AI kind by player id
+    pthread_t thread;
+    int running;                     // a thread was started and not joined yet
+    _Atomic int stop;
+
+    // the hint, guarded by lock
+    pthread_mutex_t lock;
+    pthread_cond_t hint_done;
+    int hint_state;
+    Move hint;
+    int hint_depth;
+
+    // written by the thread, read after it is joined
+    Reply replies[PONDER_MAX_REPLIES];
+    int num_replies;
+};
+
+// Create a ponderer around a borrowed search
+Ponder *ponder_create(Search *search)
+{
+    Ponder *ponder;
+    if (!search) return NULL;
+    ponder = calloc(1, sizeof(Ponder));
+    if (!ponder) return NULL;
+    ponder->search = search;
+    pthread_mutex_init(&ponder->lock, NULL);
+    pthread_cond_init(&ponder->hint_done, NULL);
+    return ponder;
+}
+
+// Stop the thread and free the ponderer
+void ponder_free(Ponder *ponder)
+{
+    if (!ponder) return;
+    ponder_stop(ponder);
+    pthread_mutex_destroy(&ponder->lock);
+    pthread_cond_destroy(&ponder->hint_done);
+    free_board(ponder->board);
+    free(ponder);
+}
+
+// Publish the hint and wake up anyone waiting for it
+static void set_hint(Ponder *ponder, int state, const Move *move, int depth)
+{
+    pthread_mutex_lock(&ponder->lock);
+    if (move) ponder->hint = *move;
+    ponder->hint_depth = depth;
+    ponder->hint_state = state;
+    pthread_cond_broadcast(&ponder->hint_done);
+    pthread_mutex_unlock(&ponder->lock);
+}
+
+// Put the hint first and the other moves after it, most fish first
+static void order_replies(Move *moves, int n, const Move *hint)
+{
+    int i, j;
+    for (i = 1; i < n; i++)
+    {
+        Move m = moves[i];
+        for (j = i; j > 0 && moves[j - 1].fish < m.fish; j--)
+            moves[j] = moves[j - 1];
+        moves[j] = m;
+    }
+    for (i = 0; i < n; i++)
+    {
+        if (moves[i].from == hint->from && moves[i].to == hint->to)
+        {
+            Move m = moves[i];
+            for (j = i; j > 0; j--)
+                moves[j] = moves[j - 1];
+            moves[0] = m;
+            break;
+        }
+    }
+}
+
+// Thread body: the hint, then a reply to each of the human's moves until stopped
+static void *think(void *arg)
+{
+    Ponder *ponder = (Ponder *)arg;
+    Board *board = ponder->board;
+    Move moves[MAX_MOVES], hint;
+    int n, i;
+
+    if (!search_best_move(ponder->search, board, ponder->num_players, ponder->human, &hint) ||
+        atomic_load(&ponder->stop))
+    {
+        set_hint(ponder, HINT_NONE, NULL, 0);
+        return NULL;
+    }
+    set_hint(ponder, HINT_READY, &hint, search_last_stats(ponder->search)->depth);
+
+    n = board_gen_moves(board, ponder->human, moves);
+    order_replies(moves, n, &hint);
+    for (i = 0; i < n && !atomic_load(&ponder->stop); i++)
+    {
+        MoveDelta delta;
+        Move reply;
+        int next;
+
+        make_move(board, ponder->human, moves[i].from, moves[i].to, &delta);
+        next = board_next_mover(board, ponder->num_players, ponder->human % ponder->num_players + 1);
+        if (next && ponder->is_ai[next] == AI_SEARCH &&
+            search_best_move(ponder->search, board, ponder->num_players, next, &reply) &&
+            !atomic_load(&ponder->stop))
+        {
+            Reply *r = &ponder->replies[ponder->num_replies++];
+            r->key = board->hash;
+            r->player = next;
+            r->move = reply;
+            r->depth = search_last_stats(ponder->search)->depth;
+        }
+        unmake_move(board, &delta);
+    }
+    return NULL;
+}
+
+// Copy the position and start the thread, unless one is already thinking
+int ponder_start(Ponder *ponder, const Game *game, int idx)
+{
+    const Board *board = game->board;
+    int i;
+
+    if (ponder->running)
+        return 1;
+    if (!ponder->board || ponder->board->rows != board->rows || ponder->board->cols != board->cols)
+    {
+        free_board(ponder->board);
+        ponder->board = create_board(board->rows, board->cols);
+        if (!ponder->board)
+            return 0;
+    }
+    board_copy(ponder->board, board);
+    ponder->num_players = game->num_players;
+    ponder->human = game->players[idx].id;
+    for (i = 0; i < game->num_players; i++)
+        ponder->is_ai[game->players[i].id] = game->players[i].is_ai;
+    ponder->num_replies = 0;
+    ponder->hint_state = HINT_PENDING;
+    atomic_store(&ponder->stop, 0);
+    search_set_stop(ponder->search, 0);
+
+    if (pthread_create(&ponder->thread, NULL, think, ponder) != 0)
+    {
+        ponder->hint_state = HINT_NONE;
+        return 0;
+    }
+    ponder->running = 1;
+    return 1;
+}
+
+// Stop the search in progress and join the thread
+void ponder_stop(Ponder *ponder)
+{
+    if (!ponder->running)
+        return;
+    atomic_store(&ponder->stop, 1);
+    search_set_stop(ponder->search, 1);
+    pthread_join(ponder->thread, NULL);
+    search_set_stop(ponder->search, 0);
+    ponder->running = 0;
+}
+
+// Wait for the thread to publish the hint
+int ponder_hint(Ponder *ponder, Move *move, int *depth)
+{
+    int ready;
+
+    pthread_mutex_lock(&ponder->lock);
+    while (ponder->hint_state == HINT_PENDING)
+        pthread_cond_wait(&ponder->hint_done, &ponder->lock);
+    ready = ponder->hint_state == HINT_READY;
+    if (ready)
+    {
+        *move = ponder->hint;
+        *depth = ponder->hint_depth;
+    }
+    pthread_mutex_unlock(&ponder->lock);
+    return ready;
+}
+
+// Find a finished reply for this position; the move is checked against the board in case two hashes collide
+int ponder_reply(Ponder *ponder, const Board *board, int player_id, Move *move, int *depth)
+{
+    Move moves[MAX_MOVES];
+    int i, k, n;
+
+    if (ponder->running)
+        return 0;
+    for (i = 0; i < ponder->num_replies; i++)
+    {
+        const Reply *r = &ponder->replies[i];
+        if (r->key != board->hash || r->player != player_id)
+            continue;
+        n = board_gen_moves(board, player_id, moves);
+        for (k = 0; k < n; k++)
+        {
+            if (moves[k].from == r->move.from && moves[k].to == r->move.to)
+            {
+                *move = moves[k];
+                *depth = r->depth;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
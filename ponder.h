@@ -0,0 +1,44 @@
+#ifndef PONDER_H
+#define PONDER_H
+
+// This header declares the ponderer, which thinks while a human types.
+// During a human's turn a background thread works on its own copy of the
+// board with the search engine. It first finds the move it would play in the
+// human's place, which is the hint, then tries each of the human's moves
+// (the hint first, then by fish) and searches the reply of the next player
+// if that player is a search AI. When the human has moved, the AI looks its
+// position up and plays the reply at once if it was found. The game's board
+// is only read when thinking starts, so the human's commands and the thread
+// never share it; the thread must be stopped before the game changes.
+
+#include "game.h"
+
+// Replies kept from one human turn: one per move the human can make.
+#define PONDER_MAX_REPLIES MAX_MOVES
+
+// Create a ponderer that thinks with search, which it borrows: nothing else
+// may use the search while the ponderer thinks. Returns NULL on failure.
+Ponder *ponder_create(Search *search);
+
+// Stop thinking and free the ponderer (not the search).
+void ponder_free(Ponder *ponder);
+
+// Start thinking about the game's position with player idx (a human) to
+// move. Does nothing if it is already thinking. Returns 0 if the thread
+// cannot be started or the board cannot be copied.
+int ponder_start(Ponder *ponder, const Game *game, int idx);
+
+// Stop thinking and wait for the thread. The finished results are kept; a
+// search that was cut short is dropped. Does nothing if it is not thinking.
+void ponder_stop(Ponder *ponder);
+
+// Wait until the hint for the position being thought about is ready.
+// Returns 1 with the move and the depth it was searched to, 0 if there is
+// none (the human cannot move, or thinking was stopped first).
+int ponder_hint(Ponder *ponder, Move *move, int *depth);
+
+// Look up the reply found for player_id in this position. Returns 1 with the
+// move and its depth if the position was searched to the end, 0 otherwise.
+int ponder_reply(Ponder *ponder, const Board *board, int player_id, Move *move, int *depth);
+
+#endif
@@ -0,0 +1,229 @@
+/* This file implements the profiling counters declared in prof.h.
+   A thread gets its own counter block the first time it counts something;
+   blocks are linked into one list under a mutex and never freed, so the
+   totals of worker threads that already finished still reach the report.
+   AI decision times go into power-of-two buckets of nanoseconds. Without
+   -DPENGUIN_PROFILE this file compiles to nothing. */
+
+#ifdef PENGUIN_PROFILE
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "prof.h"
+
+// Histogram buckets: bucket b counts times below 2^(b+1) ns (the last one everything longer)
+#define PROF_BUCKETS 40
+
+static const char *counter_names[PROF_COUNTERS] = {
+    "can_place", "find_penguin", "player_can_move", "is_valid_move", "board_gen_moves",
+    "board_has_moves", "find_first_placement", "find_best_adjacent_move", "board_set",
+    "make_move", "unmake_move"
+};
+
+static const char *scan_names[PROF_SCANS] = {
+    "init_board", "board_refresh", "board_copy", "placement_search", "placement_eval",
+    "save_image", "load_image"
+};
+
+static const char *phase_names[PROF_PHASES] = { "placement", "movement" };
+
+// One thread's counters.
+typedef struct ProfBlock {
+    long counters[PROF_COUNTERS];
+    long scans[PROF_SCANS];
+    long scan_tiles[PROF_SCANS];
+    long phase_calls[PROF_PHASES];
+    long long phase_ns[PROF_PHASES];
+    long long phase_start[PROF_PHASES];
+    long ai_moves;
+    long long ai_ns, ai_max_ns, ai_start;
+    long ai_hist[PROF_BUCKETS];
+    struct ProfBlock *next;
+} ProfBlock;
+
+static pthread_mutex_t blocks_lock = PTHREAD_MUTEX_INITIALIZER;
+static ProfBlock *blocks;
+static _Thread_local ProfBlock *self;
+static const char *report_file;
+
+// Monotonic time in nanoseconds
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// This thread's block, created and linked in on first use
+static ProfBlock *block(void)
+{
+    static ProfBlock fallback;   // counts go somewhere even if calloc fails
+
+    if (self)
+        return self;
+    self = calloc(1, sizeof(ProfBlock));
+    if (!self)
+        return &fallback;
+    pthread_mutex_lock(&blocks_lock);
+    self->next = blocks;
+    blocks = self;
+    pthread_mutex_unlock(&blocks_lock);
+    return self;
+}
+
+void prof_count(int counter)
+{
+    block()->counters[counter]++;
+}
+
+void prof_scan(int scan, long tiles)
+{
+    ProfBlock *b = block();
+    b->scans[scan]++;
+    b->scan_tiles[scan] += tiles;
+}
+
+void prof_phase_begin(int phase)
+{
+    block()->phase_start[phase] = now_ns();
+}
+
+void prof_phase_end(int phase)
+{
+    ProfBlock *b = block();
+    b->phase_calls[phase]++;
+    b->phase_ns[phase] += now_ns() - b->phase_start[phase];
+}
+
+void prof_ai_begin(void)
+{
+    block()->ai_start = now_ns();
+}
+
+void prof_ai_end(void)
+{
+    ProfBlock *b = block();
+    long long ns = now_ns() - b->ai_start;
+    int bucket = 0;
+
+    while (bucket < PROF_BUCKETS - 1 && ns >= 2LL << bucket)
+        bucket++;
+    b->ai_hist[bucket]++;
+    b->ai_moves++;
+    b->ai_ns += ns;
+    if (ns > b->ai_max_ns)
+        b->ai_max_ns = ns;
+}
+
+// Estimate the q-th fraction of the AI times: find the bucket holding it, then
+// interpolate by rank between the bucket's bounds, with the longest time seen
+// as the upper bound of the last bucket in use (and of the open-ended last one)
+static long long hist_quantile(const long *hist, long count, long long max_ns, double q)
+{
+    long seen = 0, need = (long)(q * count + 0.5);
+    int b;
+    if (need < 1) need = 1;
+    for (b = 0; b < PROF_BUCKETS; b++)
+    {
+        long long lo = b ? 1LL << b : 0, hi = 2LL << b;
+        if (seen + hist[b] < need)
+        {
+            seen += hist[b];
+            continue;
+        }
+        if (b == PROF_BUCKETS - 1 || hi > max_ns)
+            hi = max_ns;
+        if (hi < lo)
+            hi = lo;
+        return lo + (long long)((double)(hi - lo) * (need - seen) / hist[b]);
+    }
+    return max_ns;
+}
+
+int prof_write_json(FILE *fp)
+{
+    ProfBlock total;
+    const ProfBlock *b;
+    int i, last;
+
+    // add up every thread's block
+    memset(&total, 0, sizeof(total));
+    pthread_mutex_lock(&blocks_lock);
+    for (b = blocks; b; b = b->next)
+    {
+        for (i = 0; i < PROF_COUNTERS; i++)
+            total.counters[i] += b->counters[i];
+        for (i = 0; i < PROF_SCANS; i++)
+        {
+            total.scans[i] += b->scans[i];
+            total.scan_tiles[i] += b->scan_tiles[i];
+        }
+        for (i = 0; i < PROF_PHASES; i++)
+        {
+            total.phase_calls[i] += b->phase_calls[i];
+            total.phase_ns[i] += b->phase_ns[i];
+        }
+        for (i = 0; i < PROF_BUCKETS; i++)
+            total.ai_hist[i] += b->ai_hist[i];
+        total.ai_moves += b->ai_moves;
+        total.ai_ns += b->ai_ns;
+        if (b->ai_max_ns > total.ai_max_ns)
+            total.ai_max_ns = b->ai_max_ns;
+    }
+    pthread_mutex_unlock(&blocks_lock);
+
+    fprintf(fp, "{\n  \"calls\": {");
+    for (i = 0; i < PROF_COUNTERS; i++)
+        fprintf(fp, "%s\n    \"%s\": %ld", i ? "," : "", counter_names[i], total.counters[i]);
+
+    fprintf(fp, "\n  },\n  \"scans\": {");
+    for (i = 0; i < PROF_SCANS; i++)
+        fprintf(fp, "%s\n    \"%s\": { \"count\": %ld, \"tiles\": %ld }", i ? "," : "",
+                scan_names[i], total.scans[i], total.scan_tiles[i]);
+
+    fprintf(fp, "\n  },\n  \"phases\": {");
+    for (i = 0; i < PROF_PHASES; i++)
+        fprintf(fp, "%s\n    \"%s\": { \"count\": %ld, \"total_ms\": %.3f }", i ? "," : "",
+                phase_names[i], total.phase_calls[i], total.phase_ns[i] / 1e6);
+
+    // the histogram stops at the last bucket in use
+    for (last = PROF_BUCKETS - 1; last > 0 && total.ai_hist[last] == 0; last--)
+        ;
+    fprintf(fp, "\n  },\n  \"ai_decision_ns\": {\n"
+                "    \"count\": %ld,\n    \"mean\": %.1f,\n    \"p50\": %lld,\n    \"p90\": %lld,\n"
+                "    \"p99\": %lld,\n    \"max\": %lld,\n    \"buckets\": [",
+            total.ai_moves, total.ai_moves ? (double)total.ai_ns / total.ai_moves : 0.0,
+            total.ai_moves ? hist_quantile(total.ai_hist, total.ai_moves, total.ai_max_ns, 0.5) : 0,
+            total.ai_moves ? hist_quantile(total.ai_hist, total.ai_moves, total.ai_max_ns, 0.9) : 0,
+            total.ai_moves ? hist_quantile(total.ai_hist, total.ai_moves, total.ai_max_ns, 0.99) : 0,
+            total.ai_max_ns);
+    for (i = 0; i <= last && total.ai_moves; i++)
+        fprintf(fp, "%s\n      { \"below\": %lld, \"count\": %ld }", i ? "," : "", 2LL << i, total.ai_hist[i]);
+    fprintf(fp, "\n    ]\n  }\n}\n");
+    return !ferror(fp);
+}
+
+// atexit handler
+static void write_report(void)
+{
+    FILE *fp = fopen(report_file, "w");
+    if (!fp || !prof_write_json(fp))
+        fprintf(stderr, "Cannot write the profile to %s.\n", report_file);
+    else
+        fprintf(stderr, "Profile written to %s.\n", report_file);
+    if (fp)
+        fclose(fp);
+}
+
+void prof_report_at_exit(const char *file)
+{
+    if (!report_file)
+        atexit(write_report);
+    report_file = file;
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef PROF_H
+#define PROF_H
+
+// This header declares the optional profiling counters.
+// Building with -DPENGUIN_PROFILE counts board query calls and full-board
+// scans, times the placement and movement phases and keeps a histogram of
+// AI decision times, then writes everything as JSON when the program exits.
+// Without the flag every PROF_* macro expands to nothing, so the counters
+// cost nothing in a normal build. Each thread counts into its own block;
+// the blocks are only added up for the report.
+
+#include <stdio.h>
+
+// Board queries and updates whose calls are counted.
+enum {
+    PROF_CAN_PLACE,
+    PROF_FIND_PENGUIN,
+    PROF_PLAYER_CAN_MOVE,
+    PROF_IS_VALID_MOVE,
+    PROF_GEN_MOVES,
+    PROF_HAS_MOVES,
+    PROF_FIND_FIRST_PLACEMENT,
+    PROF_FIND_BEST_MOVE,
+    PROF_BOARD_SET,
+    PROF_MAKE_MOVE,
+    PROF_UNMAKE_MOVE,
+    PROF_COUNTERS
+};
+
+// Passes over the whole board (or up to the first hit); each also adds the tiles it covered.
+enum {
+    PROF_SCAN_INIT,        // init_board
+    PROF_SCAN_REFRESH,     // board_refresh
+    PROF_SCAN_COPY,        // board_copy
+    PROF_SCAN_PLACEMENT,   // plane search behind find_first_placement
+    PROF_SCAN_PLACEMENT_EVAL, // the three passes of placement_choose
+    PROF_SCAN_SAVE,        // save image
+    PROF_SCAN_LOAD,        // unpacking a save image
+    PROF_SCANS
+};
+
+// Timed phases.
+enum {
+    PROF_PLACEMENT,
+    PROF_MOVEMENT,
+    PROF_PHASES
+};
+
+// Report file written at exit
+#define PROF_FILE "penguin-profile.json"
+
+#ifdef PENGUIN_PROFILE
+
+#define PROF_COUNT(counter)         prof_count(counter)
+#define PROF_SCAN(scan, tiles)      prof_scan(scan, tiles)
+#define PROF_PHASE_BEGIN(phase)     prof_phase_begin(phase)
+#define PROF_PHASE_END(phase)       prof_phase_end(phase)
+#define PROF_AI_BEGIN()             prof_ai_begin()
+#define PROF_AI_END()               prof_ai_end()
+#define PROF_REPORT_AT_EXIT(file)   prof_report_at_exit(file)
+
+void prof_count(int counter);
+void prof_scan(int scan, long tiles);
+void prof_phase_begin(int phase);
+void prof_phase_end(int phase);
+void prof_ai_begin(void);
+void prof_ai_end(void);
+
+// Write the totals of all threads as JSON. Returns 0 on a write error.
+int prof_write_json(FILE *fp);
+
+// Write the report to file when the program exits, however it exits.
+void prof_report_at_exit(const char *file);
+
+#else
+
+#define PROF_COUNT(counter)         ((void)0)
+#define PROF_SCAN(scan, tiles)      ((void)0)
+#define PROF_PHASE_BEGIN(phase)     ((void)0)
+#define PROF_PHASE_END(phase)       ((void)0)
+#define PROF_AI_BEGIN()             ((void)0)
+#define PROF_AI_END()               ((void)0)
+#define PROF_REPORT_AT_EXIT(file)   ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,444 @@
+/* This file implements the terminal renderer declared in render.h.
+   A frame is collected in one buffer sized for the visible window and handed
+   to the terminal with a single write(). In screen mode the window is drawn
+   once at the top of the screen and the lines below it become the scrolling
+   region for game messages; after that a frame only moves the cursor to the
+   tiles that differ from the copy of the last frame and rewrites those.
+   Boards bigger than the terminal are shown through a window that jumps to
+   keep the focus tile in view, so a frame costs the same on any board size. */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "render.h"
+
+// ANSI color codes for terminal output
+#define CLR_RESET  "\x1b[0m"
+#define CLR_BLUE   "\x1b[34m"
+#define CLR_RED    "\x1b[31m"
+#define CLR_GREEN  "\x1b[32m"
+#define CLR_YELLOW "\x1b[33m"
+
+// Screen lines above the first board row (window position and column numbers)
+#define TOP_LINES 2
+
+// Fewest lines screen mode leaves below the board for messages and prompts
+#define MIN_MESSAGE_LINES 6
+
+// Smallest window, in tiles, screen mode is willing to show
+#define MIN_VIEW 5
+
+// Boards up to this size are printed whole in plain mode; larger ones through a window
+#define PLAIN_FULL_SIDE 99
+#define PLAIN_VIEW_ROWS 24
+#define PLAIN_VIEW_COLS 24
+
+// Worst-case bytes for one tile: cursor move plus a coloured cell
+#define TILE_BYTES 32
+
+struct Renderer {
+    char *buf;        // frame buffer, TILE_BYTES per visible tile plus headers
+    size_t cap;
+    size_t len;
+    Tile *shown;      // visible tiles as the screen shows them (screen mode)
+    size_t shown_len; // tiles shown has room for
+    int rows, cols;   // board size the window was made for
+    int vr, vc;       // window size in tiles
+    int top, left;    // board row and column at the window's top left corner
+    int label;        // digits in the row labels
+    int screen;       // 1 = board fixed at the top, frames rewrite changed tiles only
+    int drawn;        // 1 while the whole window is on the screen
+    int term_rows;    // terminal height when the board was last drawn in full
+    int term_cols;
+};
+
+// Renderer whose terminal settings are undone if the program exits early
+static Renderer *active_view;
+
+// Return a color string based on player id
+static const char *player_color(int owner)
+{
+    switch (owner)
+    {
+        case 1: return CLR_BLUE;
+        case 2: return CLR_RED;
+        case 3: return CLR_GREEN;
+        case 4: return CLR_YELLOW;
+        default: return CLR_RESET;
+    }
+}
+
+// Append bytes to the frame
+static void put(Renderer *view, const char *s, size_t n)
+{
+    memcpy(view->buf + view->len, s, n);
+    view->len += n;
+}
+
+// Append a string to the frame
+static void put_str(Renderer *view, const char *s)
+{
+    put(view, s, strlen(s));
+}
+
+// Append formatted text to the frame (headers and cursor moves only)
+static void put_fmt(Renderer *view, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(view->buf + view->len, view->cap - view->len, fmt, ap);
+    va_end(ap);
+    if (n > 0)
+        view->len += (size_t)n;
+}
+
+// Append one 5-column cell: water, fish, or fish with a coloured owner
+static void put_tile(Renderer *view, Tile t)
+{
+    int fish = tile_fish(t);
+    int owner = tile_owner(t);
+    char cell[5];
+
+    // Print empty water tile
+    if (fish == 0 && owner == 0)
+    {
+        put(view, "  -- ", 5);
+        return;
+    }
+
+    cell[0] = ' ';
+    cell[1] = (char)('0' + fish);
+    cell[2] = '(';
+    cell[3] = (char)('0' + owner);
+    cell[4] = ')';
+    if (owner == 0)
+    {
+        put(view, cell, 5);
+        return;
+    }
+
+    // Print tile with a penguin owner in color
+    put(view, cell, 3);
+    put_str(view, player_color(owner));
+    put(view, cell + 3, 1);
+    put_str(view, CLR_RESET);
+    put(view, cell + 4, 1);
+}
+
+// Hand the frame to the terminal in one write, after anything stdio still holds
+static void flush_frame(Renderer *view)
+{
+    size_t done = 0;
+
+    fflush(stdout);
+    while (done < view->len)
+    {
+        ssize_t n = write(STDOUT_FILENO, view->buf + done, view->len - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += (size_t)n;
+    }
+    view->len = 0;
+}
+
+// Put the whole terminal back to normal scrolling below whatever is on it
+static void release_screen(Renderer *view)
+{
+    if (!view->screen || !view->drawn)
+        return;
+
+    // resetting the region homes the cursor, so move it to the bottom line again
+    put_str(view, "\033[r");
+    put_fmt(view, "\033[%d;%dH\n", view->term_rows, 1);
+    flush_frame(view);
+    view->drawn = 0;
+}
+
+// Undo the scrolling region if the game exits while the board is on screen
+static void release_at_exit(void)
+{
+    if (active_view)
+        release_screen(active_view);
+}
+
+// Create a renderer; buffers are made on the first frame
+Renderer *renderer_create(void)
+{
+    static int registered = 0;
+    Renderer *view = calloc(1, sizeof(Renderer));
+    if (!view) return NULL;
+
+    if (!registered)
+    {
+        atexit(release_at_exit);
+        registered = 1;
+    }
+    return view;
+}
+
+// Free the renderer after giving the terminal back
+void renderer_free(Renderer *view)
+{
+    if (!view) return;
+    release_screen(view);
+    if (active_view == view)
+        active_view = NULL;
+    free(view->buf);
+    free(view->shown);
+    free(view);
+}
+
+// Digits needed for the largest row number, at least 2
+static int label_width(int rows)
+{
+    int w = 2;
+    while (rows >= 100)
+    {
+        rows /= 10;
+        w++;
+    }
+    return w;
+}
+
+// Pick screen or plain mode and the window size for this board and terminal
+static void choose_window(Renderer *view, const Board *board)
+{
+    struct winsize ws;
+    int avail_rows, avail_cols;
+
+    view->label = label_width(board->rows);
+    view->screen = 0;
+    if (isatty(STDOUT_FILENO) && ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0)
+    {
+        avail_rows = ws.ws_row - TOP_LINES - 1 - MIN_MESSAGE_LINES;
+        avail_cols = (ws.ws_col - view->label - 2) / 5;
+        if (avail_rows >= MIN_VIEW && avail_cols >= MIN_VIEW)
+        {
+            view->screen = 1;
+            view->term_rows = ws.ws_row;
+            view->term_cols = ws.ws_col;
+            view->vr = board->rows < avail_rows ? board->rows : avail_rows;
+            view->vc = board->cols < avail_cols ? board->cols : avail_cols;
+            return;
+        }
+    }
+
+    // plain text: small boards whole, as they always were; large ones through a window
+    if (board->rows <= PLAIN_FULL_SIDE && board->cols <= PLAIN_FULL_SIDE)
+    {
+        view->vr = board->rows;
+        view->vc = board->cols;
+    }
+    else
+    {
+        view->vr = board->rows < PLAIN_VIEW_ROWS ? board->rows : PLAIN_VIEW_ROWS;
+        view->vc = board->cols < PLAIN_VIEW_COLS ? board->cols : PLAIN_VIEW_COLS;
+    }
+}
+
+// Make the frame buffer and the screen copy fit the window
+static int ensure_buffers(Renderer *view)
+{
+    size_t tiles = (size_t)view->vr * view->vc;
+    size_t cap = tiles * TILE_BYTES + (size_t)view->vc * 8 + (size_t)view->vr * (16 + view->label) + 256;
+    char *buf;
+    Tile *shown;
+
+    if (view->buf && view->cap == cap && view->shown_len == tiles)
+        return 1;
+
+    buf = malloc(cap);
+    shown = malloc(tiles * sizeof(Tile));
+    if (!buf || !shown)
+    {
+        free(buf);
+        free(shown);
+        return 0;
+    }
+
+    free(view->buf);
+    free(view->shown);
+    view->buf = buf;
+    view->shown = shown;
+    view->cap = cap;
+    view->shown_len = tiles;
+    view->len = 0;
+    return 1;
+}
+
+// Move the window so the focus tile is inside it, centred when it has to move.
+// Returns 1 if the window moved.
+static int follow(Renderer *view, const Board *board, int focus)
+{
+    int fr, fc, top = view->top, left = view->left;
+
+    if (focus >= 0)
+    {
+        fr = focus / board->cols;
+        fc = focus % board->cols;
+        if (fr < top || fr >= top + view->vr)
+            top = fr - view->vr / 2;
+        if (fc < left || fc >= left + view->vc)
+            left = fc - view->vc / 2;
+    }
+
+    // keep the window on the board
+    if (top > board->rows - view->vr) top = board->rows - view->vr;
+    if (left > board->cols - view->vc) left = board->cols - view->vc;
+    if (top < 0) top = 0;
+    if (left < 0) left = 0;
+
+    if (top == view->top && left == view->left)
+        return 0;
+    view->top = top;
+    view->left = left;
+    return 1;
+}
+
+// Append the window as text, in the same layout in both modes
+static void put_board(Renderer *view, const Board *board)
+{
+    int i, j;
+
+    // a window smaller than the board says which part it shows
+    if (view->vr < board->rows || view->vc < board->cols)
+        put_fmt(view, "rows %d-%d of %d, cols %d-%d of %d", view->top + 1, view->top + view->vr,
+                board->rows, view->left + 1, view->left + view->vc, board->cols);
+    if (view->screen)
+        put_str(view, "\033[K");
+    put_fmt(view, "\n%*s", view->label + 2, "");
+    for (j = view->left; j < view->left + view->vc; j++)
+        put_fmt(view, j + 1 < 1000 ? "%3d  " : "%4d ", j + 1);
+    put_str(view, "\n");
+
+    for (i = view->top; i < view->top + view->vr; i++)
+    {
+        put_fmt(view, "%*d |", view->label, i + 1);
+        for (j = view->left; j < view->left + view->vc; j++)
+            put_tile(view, board->tiles[i * board->cols + j]);
+        put_str(view, "\n");
+    }
+    put_str(view, "\n");
+}
+
+// Remember the visible tiles as the screen now shows them
+static void copy_shown(Renderer *view, const Board *board)
+{
+    int i;
+    for (i = 0; i < view->vr; i++)
+        memcpy(view->shown + (size_t)i * view->vc,
+               board->tiles + (size_t)(view->top + i) * board->cols + view->left,
+               (size_t)view->vc * sizeof(Tile));
+}
+
+// Draw the board around the focus tile (-1 = keep the window where it is),
+// rewriting only changed tiles once it is fixed on the screen
+void render_board(Renderer *view, const Board *board, int focus)
+{
+    int i, j, changed = 0;
+
+    // a new board size starts over with a fresh window
+    if (view->rows != board->rows || view->cols != board->cols)
+    {
+        release_screen(view);
+        view->rows = board->rows;
+        view->cols = board->cols;
+        view->top = 0;
+        view->left = 0;
+    }
+
+    if (!view->drawn)
+        choose_window(view, board);
+    if (!ensure_buffers(view))
+        return;
+
+    if (!view->screen)
+    {
+        follow(view, board, focus);
+        put_board(view, board);
+        flush_frame(view);
+        return;
+    }
+
+    if (!view->drawn)
+    {
+        // board at the top, messages scroll in the region below it
+        int top = TOP_LINES + view->vr + 2;
+        follow(view, board, focus);
+        put_str(view, "\033[2J\033[H");
+        put_board(view, board);
+        put_fmt(view, "\033[%d;%dr", top, view->term_rows);
+        put_fmt(view, "\033[%d;%dH", top, 1);
+        copy_shown(view, board);
+        view->drawn = 1;
+        active_view = view;
+        flush_frame(view);
+        return;
+    }
+
+    // the window scrolled: rewrite all of it in place, messages stay below
+    if (follow(view, board, focus))
+    {
+        put_str(view, "\0337\033[H");
+        put_board(view, board);
+        put_str(view, "\0338");
+        copy_shown(view, board);
+        flush_frame(view);
+        return;
+    }
+
+    // save the message cursor, patch the changed tiles, then put it back
+    put_str(view, "\0337");
+    for (i = 0; i < view->vr; i++)
+    {
+        const Tile *row = board->tiles + (size_t)(view->top + i) * board->cols + view->left;
+        Tile *seen = view->shown + (size_t)i * view->vc;
+        for (j = 0; j < view->vc; j++)
+        {
+            if (seen[j] == row[j])
+                continue;
+            put_fmt(view, "\033[%d;%dH", TOP_LINES + 1 + i, view->label + 3 + 5 * j);
+            put_tile(view, row[j]);
+            seen[j] = row[j];
+            changed++;
+        }
+    }
+    put_str(view, "\0338");
+
+    // an unchanged board costs no write at all
+    if (!changed)
+    {
+        view->len = 0;
+        return;
+    }
+    flush_frame(view);
+}
+
+// Clear the terminal and forget what was on it
+void render_clear_screen(Renderer *view)
+{
+    if (view->drawn)
+    {
+        put_str(view, "\033[r");
+        view->drawn = 0;
+    }
+    if (!view->buf)
+    {
+        // nothing drawn yet: no frame buffer to collect into
+        fputs("\033[2J\033[H", stdout);
+        fflush(stdout);
+        return;
+    }
+    put_str(view, "\033[2J\033[H");
+    flush_frame(view);
+}
@@ -0,0 +1,30 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+// This header declares the terminal renderer for the board.
+// Every frame is built in one preallocated buffer and written with a single
+// write(). On a terminal tall enough for the board, the board stays at the
+// top of the screen and later frames only rewrite the tiles that changed,
+// while game messages scroll in the lines below it. When output is not a
+// terminal, or the terminal is too small, every frame prints the whole
+// board as plain text. Boards larger than the terminal (or, in plain text,
+// larger than 99x99) are drawn through a window that follows a focus tile.
+
+#include "board.h"
+
+typedef struct Renderer Renderer;
+
+// Create a renderer that draws to standard output. Returns NULL on failure.
+Renderer *renderer_create(void);
+
+// Give the terminal back (scrolling region, cursor) and free the renderer.
+void renderer_free(Renderer *view);
+
+// Draw the board: only the changed tiles in screen mode, the whole window otherwise.
+// The window moves to show the focus tile (a tile index); -1 leaves it where it is.
+void render_board(Renderer *view, const Board *board, int focus);
+
+// Clear the terminal; the next frame draws the whole board again.
+void render_clear_screen(Renderer *view);
+
+#endif
@@ -0,0 +1,219 @@
+/* This file implements the replay recorder declared in replay.h.
+   Records, keyframe images and the keyframe index each live in their own
+   growing buffer while the game runs; replay_finish lays them out as one
+   block behind a header and hands it to the output file with a single
+   fwrite, which stdio keeps whole even when threads share the file. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "replay.h"
+#include "checksum.h"
+
+// One keyframe in the index.
+typedef struct {
+    uint32_t turn;      // turns played before the keyframe
+    uint32_t record;    // records before the keyframe
+    size_t offset;      // image offset in the keyframe buffer
+} Keyframe;
+
+struct Replay {
+    FILE *out;
+    uint32_t *records;
+    size_t count, cap;
+    uint32_t turns;           // placements and moves among the records
+    uint32_t keyframe_every;  // turns between keyframes for this board size
+    unsigned char *frames;    // keyframe images back to back
+    size_t frames_len, frames_cap;
+    Keyframe *index;
+    int keyframes;
+    size_t index_cap;
+    unsigned char *block;     // the finished block, kept for the next game
+    size_t block_cap;
+    int rows, cols, num_players;
+    uint64_t seed;
+    int recording;            // 1 between replay_begin and replay_finish
+    int failed;               // 1 once memory ran out or the board was too big
+};
+
+// Store a 32-bit value little-endian
+static void put_u32(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+// Store a 64-bit value little-endian
+static void put_u64(unsigned char *p, uint64_t v)
+{
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+// Grow a buffer to hold at least need elements; doubling keeps appends cheap
+static int grow(void **buf, size_t *cap, size_t need, size_t elem)
+{
+    size_t n = *cap ? *cap : 64;
+    void *p;
+
+    if (need <= *cap)
+        return 1;
+    while (n < need)
+        n *= 2;
+    p = realloc(*buf, n * elem);
+    if (!p) return 0;
+    *buf = p;
+    *cap = n;
+    return 1;
+}
+
+// Create a recorder writing to out
+Replay *replay_create(FILE *out)
+{
+    Replay *replay = calloc(1, sizeof(Replay));
+    if (!replay) return NULL;
+    replay->out = out;
+    return replay;
+}
+
+// Free the recorder and its buffers
+void replay_free(Replay *replay)
+{
+    if (!replay) return;
+    free(replay->records);
+    free(replay->frames);
+    free(replay->index);
+    free(replay->block);
+    free(replay);
+}
+
+// Store the current position as a keyframe after the records so far; the
+// image is built straight into the frame buffer
+static void add_keyframe(Replay *replay, const Game *game)
+{
+    size_t size = save_game_image_size(game);
+    Keyframe *k;
+
+    if (!grow((void **)&replay->frames, &replay->frames_cap, replay->frames_len + size, 1) ||
+        !grow((void **)&replay->index, &replay->index_cap, (size_t)replay->keyframes + 1, sizeof(Keyframe)))
+    {
+        replay->failed = 1;
+        return;
+    }
+
+    k = &replay->index[replay->keyframes++];
+    k->turn = replay->turns;
+    k->record = (uint32_t)replay->count;
+    k->offset = replay->frames_len;
+    save_game_image_to(game, replay->frames + replay->frames_len, size);
+    replay->frames_len += size;
+}
+
+// Start a new game: drop anything recorded so far and keyframe the start
+void replay_begin(Replay *replay, const Game *game)
+{
+    replay->count = 0;
+    replay->turns = 0;
+    replay->frames_len = 0;
+    replay->keyframes = 0;
+    replay->rows = game->board->rows;
+    replay->cols = game->board->cols;
+    replay->num_players = game->num_players;
+    replay->seed = game->seed;
+    replay->keyframe_every = REPLAY_KEYFRAME_EVERY;
+    if ((size_t)replay->rows * replay->cols / REPLAY_KEYFRAME_TILES > REPLAY_KEYFRAME_EVERY)
+        replay->keyframe_every = (uint32_t)((size_t)replay->rows * replay->cols / REPLAY_KEYFRAME_TILES);
+    replay->recording = 1;
+    replay->failed = (size_t)replay->rows * replay->cols > REPLAY_MAX_TILES;
+    if (!replay->failed)
+        add_keyframe(replay, game);
+}
+
+// Append a record, keyframing every keyframe_every turns
+void replay_turn(Replay *replay, const Game *game, int kind, int idx, int tile, int dir, int fish)
+{
+    if (!replay->recording || replay->failed)
+        return;
+    if (!grow((void **)&replay->records, &replay->cap, replay->count + 1, sizeof(uint32_t)))
+    {
+        replay->failed = 1;
+        return;
+    }
+    replay->records[replay->count++] = replay_pack(kind, idx, (uint32_t)tile, dir, fish);
+    if (kind == REPLAY_INACTIVE)
+        return;
+
+    replay->turns++;
+    if (replay->turns % replay->keyframe_every == 0)
+        add_keyframe(replay, game);
+}
+
+// Pop the drop-outs after the latest turn, then the turn and any keyframe taken after it
+void replay_unmake(Replay *replay)
+{
+    if (!replay->recording || replay->failed)
+        return;
+
+    while (replay->count > 0 && record_kind(replay->records[replay->count - 1]) == REPLAY_INACTIVE)
+        replay->count--;
+    if (replay->count == 0)
+        return;
+    replay->count--;
+    replay->turns--;
+
+    while (replay->keyframes > 1 && replay->index[replay->keyframes - 1].record > replay->count)
+    {
+        replay->keyframes--;
+        replay->frames_len = replay->index[replay->keyframes].offset;
+    }
+}
+
+// Lay the game out as one block (in a buffer reused from game to game) and write it
+int replay_finish(Replay *replay)
+{
+    size_t index_bytes = (size_t)replay->keyframes * REPLAY_INDEX_BYTES;
+    size_t records_at = REPLAY_HEADER_BYTES + index_bytes;
+    size_t frames_at = records_at + replay->count * 4;
+    size_t size = frames_at + replay->frames_len;
+    unsigned char *block, *p;
+    size_t i;
+
+    if (!replay->recording)
+        return 0;
+    replay->recording = 0;
+    if (replay->failed)
+        return 0;
+
+    if (!grow((void **)&replay->block, &replay->block_cap, size, 1))
+        return 0;
+    block = replay->block;
+
+    p = block + REPLAY_HEADER_BYTES;
+    for (i = 0; i < (size_t)replay->keyframes; i++, p += REPLAY_INDEX_BYTES)
+    {
+        put_u32(p, replay->index[i].turn);
+        put_u32(p + 4, replay->index[i].record);
+        put_u64(p + 8, frames_at + replay->index[i].offset);
+    }
+    for (i = 0; i < replay->count; i++, p += 4)
+        put_u32(p, replay->records[i]);
+    memcpy(p, replay->frames, replay->frames_len);
+
+    memcpy(block, REPLAY_MAGIC, 8);
+    put_u32(block + 8, REPLAY_VERSION);
+    put_u32(block + 12, REPLAY_HEADER_BYTES);
+    put_u32(block + 16, (uint32_t)replay->rows);
+    put_u32(block + 20, (uint32_t)replay->cols);
+    put_u32(block + 24, (uint32_t)replay->num_players);
+    put_u32(block + 28, (uint32_t)replay->keyframes);
+    put_u32(block + 32, (uint32_t)replay->count);
+    put_u32(block + 36, replay->turns);
+    put_u64(block + 40, replay->seed);
+    put_u64(block + 48, size);
+    put_u64(block + REPLAY_CHECKSUM_AT,
+            checksum64(block + REPLAY_HEADER_BYTES, frames_at - REPLAY_HEADER_BYTES,
+                       checksum64(block, REPLAY_CHECKSUM_AT, 0)));
+
+    return fwrite(block, 1, size, replay->out) == size;
+}
@@ -0,0 +1,96 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// This header declares the replay recorder.
+// A replay holds one game: its starting position, every placement and move,
+// and a keyframe (a V2 save image) every REPLAY_KEYFRAME_EVERY turns with an
+// index of them, so a reader can jump to any turn by loading the nearest
+// keyframe and playing only the moves after it. A game is collected in memory
+// and appended to the output file as one block when it ends, so many games
+// (from several threads too) can share one archive file.
+
+#include <stdio.h>
+#include <stdint.h>
+#include "game.h"
+
+// Turns (placements and moves) between two keyframes. On large boards the
+// gap grows to one turn per REPLAY_KEYFRAME_TILES tiles, so keyframes add
+// a few bytes per turn however big each of them is.
+#define REPLAY_KEYFRAME_EVERY 64
+#define REPLAY_KEYFRAME_TILES 64
+
+// Replay block layout, all integers little-endian:
+//   header (64 bytes): magic, version, header size, rows, cols, players,
+//                      keyframe count, record count, turns, seed,
+//                      block size, checksum
+//   index:     per keyframe: turn, record number (4 bytes each), offset (8 bytes)
+//   records:   4 bytes per record
+//   keyframes: V2 save images, back to back
+// The checksum is XXH64 of the index and records, seeded with XXH64 of the
+// header bytes before the checksum field. Keyframes carry their own checksum.
+#define REPLAY_MAGIC        "PENGRPL1"
+#define REPLAY_VERSION      2
+#define REPLAY_HEADER_BYTES 64
+#define REPLAY_CHECKSUM_AT  56
+#define REPLAY_INDEX_BYTES  16
+
+// A record is one 32-bit word: player index (bits 0-1), kind (bits 2-3),
+// fish collected (bits 4-5), tile index (bits 6-29) and, for a move, the
+// direction it went in (bits 30-31, as in Move.dir), which tells which of
+// the player's penguins moved. Version 1 had one penguin per player and
+// used bits 6-31 for the tile; its records carry no direction.
+#define REPLAY_PLACE    0   // a penguin was placed on the tile
+#define REPLAY_MOVE     1   // one of the player's penguins moved to the tile
+#define REPLAY_INACTIVE 2   // the player could not move and dropped out
+
+#define REPLAY_MAX_TILES (1u << 24)
+
+// Pack a record.
+static inline uint32_t replay_pack(int kind, int idx, uint32_t tile, int dir, int fish)
+{
+    return (uint32_t)idx | (uint32_t)kind << 2 | (uint32_t)fish << 4 | tile << 6 | (uint32_t)dir << 30;
+}
+
+// Fields of a record.
+static inline int record_player(uint32_t rec) { return (int)(rec & 3); }
+static inline int record_kind(uint32_t rec)   { return (int)((rec >> 2) & 3); }
+static inline int record_fish(uint32_t rec)   { return (int)((rec >> 4) & 3); }
+static inline uint32_t record_tile(uint32_t rec) { return (rec >> 6) & (REPLAY_MAX_TILES - 1); }
+static inline int record_dir(uint32_t rec)    { return (int)(rec >> 30); }
+
+typedef struct Replay Replay;
+
+// Create a recorder that appends finished games to out (opened for binary
+// writing and owned by the caller). Returns NULL on failure.
+Replay *replay_create(FILE *out);
+
+// Free the recorder; a game in progress is dropped.
+void replay_free(Replay *replay);
+
+// Start recording a game from its current position (keyframe 0).
+void replay_begin(Replay *replay, const Game *game);
+
+// Record a turn or a player dropping out; game is the position after it.
+// dir is the direction of a move (0-3), 0 for anything else.
+void replay_turn(Replay *replay, const Game *game, int kind, int idx, int tile, int dir, int fish);
+
+// Forget the latest placement or move, and any drop-outs after it (undo).
+void replay_unmake(Replay *replay);
+
+// Append the recorded game to the output file as one block and start over.
+// Returns 0 if the game could not be recorded or written.
+int replay_finish(Replay *replay);
+
+// Read a little-endian 32-bit value from a replay block.
+static inline uint32_t replay_u32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Read a little-endian 64-bit value from a replay block.
+static inline uint64_t replay_u64(const unsigned char *p)
+{
+    return (uint64_t)replay_u32(p) | (uint64_t)replay_u32(p + 4) << 32;
+}
+
+#endif
@@ -0,0 +1,458 @@
+/*
+ * Replay analyzer for Penguins Game.
+ * Streams through replay archives written with "-r" by the game or the
+ * simulator and prints one line per game: seed, stream, length, final scores and the
+ * turn at which each player dropped out, optionally followed by each seat's
+ * score curve. Games are read one block at a time and keyframes are skipped,
+ * so memory use depends on the longest game, not on the archive size.
+ * With -g and -t it instead jumps to one position: it loads the keyframe
+ * nearest before the turn and plays only the records after it.
+ *
+ * Usage: penguin-replay [-c step] file...
+ *        penguin-replay -g game -t turn file
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "board.h"
+#include "game.h"
+#include "replay.h"
+#include "checksum.h"
+
+// Buffer given to stdio for each archive
+#define READ_BUFFER (1 << 20)
+
+// Start of a V2 image as far as the summary needs it (see the layout in game.c)
+#define IMAGE_HEADER_BYTES 64
+#define IMAGE_PLAYER_BYTES 48
+#define IMAGE_RNG_BYTES    16   // seed and stream, in version 3 images
+
+// Print usage and exit
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-c step] file...\n"
+                    "       %s -g game -t turn file\n", prog, prog);
+    exit(1);
+}
+
+// Read exactly len bytes; returns 0 at a short read
+static int read_exact(FILE *fp, void *buf, size_t len)
+{
+    return fread(buf, 1, len, fp) == len;
+}
+
+// Skip len bytes, seeking when the file allows it
+static int skip_bytes(FILE *fp, uint64_t len)
+{
+    char sink[4096];
+
+    if (fseeko(fp, (off_t)len, SEEK_CUR) == 0)
+        return 1;
+    while (len > 0)
+    {
+        size_t n = len < sizeof(sink) ? (size_t)len : sizeof(sink);
+        if (!read_exact(fp, sink, n)) return 0;
+        len -= n;
+    }
+    return 1;
+}
+
+// Make sure *buf holds at least need bytes
+static int reserve(unsigned char **buf, size_t *cap, size_t need)
+{
+    unsigned char *p;
+    if (need <= *cap) return 1;
+    p = realloc(*buf, need);
+    if (!p) return 0;
+    *buf = p;
+    *cap = need;
+    return 1;
+}
+
+// Check a replay block header read from the archive (any version up to REPLAY_VERSION)
+static int check_header(const unsigned char *h, int *num_players)
+{
+    if (memcmp(h, REPLAY_MAGIC, 8) != 0 || replay_u32(h + 8) < 1 || replay_u32(h + 8) > REPLAY_VERSION ||
+        replay_u32(h + 12) != REPLAY_HEADER_BYTES)
+        return 0;
+    *num_players = (int)replay_u32(h + 24);
+    return *num_players >= 1 && *num_players <= MAX_PLAYERS && replay_u32(h + 28) >= 1;
+}
+
+// Print one seat's score after every step turns, and at the end
+static void print_curve(long game, int seat, int start, const uint32_t *recs, size_t count, int step)
+{
+    int score = start, turn = 0;
+    size_t i;
+
+    printf("curve %ld seat %d: %d", game, seat + 1, score);
+    for (i = 0; i < count; i++)
+    {
+        uint32_t rec = recs[i];
+        if (record_kind(rec) == REPLAY_INACTIVE)
+            continue;
+        if (record_player(rec) == seat)
+            score += record_fish(rec);
+        turn++;
+        if (turn % step == 0)
+            printf(" %d", score);
+    }
+    if (turn % step != 0)
+        printf(" %d", score);
+    printf("\n");
+}
+
+// Print a summary line (and curves) for every game in one archive
+static int summarize(const char *filename, int step, long *games, long *turns, uint64_t *bytes)
+{
+    FILE *fp = fopen(filename, "rb");
+    unsigned char h[REPLAY_HEADER_BYTES];
+    unsigned char *buf = NULL;
+    uint32_t *recs = NULL;
+    size_t cap = 0, recs_cap = 0;
+    int ok = 1;
+
+    if (!fp)
+    {
+        fprintf(stderr, "Cannot open %s.\n", filename);
+        return 0;
+    }
+    setvbuf(fp, NULL, _IOFBF, READ_BUFFER);
+
+    while (fread(h, 1, sizeof(h), fp) == sizeof(h))
+    {
+        int num_players, scores[MAX_PLAYERS], inactive[MAX_PLAYERS];
+        uint32_t keyframes, count, t = 0;
+        size_t body, image_head;
+        uint64_t size, stream = 0;
+        size_t i;
+        int p;
+
+        if (!check_header(h, &num_players))
+        {
+            fprintf(stderr, "%s: bad block at game %ld.\n", filename, *games);
+            ok = 0;
+            break;
+        }
+        keyframes = replay_u32(h + 28);
+        count = replay_u32(h + 32);
+        size = replay_u64(h + 48);
+
+        // index and records are checked together, then keyframe 0's player table gives the start scores
+        body = (size_t)keyframes * REPLAY_INDEX_BYTES + (size_t)count * 4;
+        image_head = IMAGE_HEADER_BYTES + (size_t)num_players * IMAGE_PLAYER_BYTES;
+        if (size < REPLAY_HEADER_BYTES + body + image_head ||
+            !reserve(&buf, &cap, body + image_head) ||
+            !read_exact(fp, buf, body + image_head) ||
+            !reserve((unsigned char **)&recs, &recs_cap, (size_t)count * sizeof(uint32_t)) ||
+            replay_u64(h + REPLAY_CHECKSUM_AT) !=
+                checksum64(buf, body, checksum64(h, REPLAY_CHECKSUM_AT, 0)))
+        {
+            fprintf(stderr, "%s: damaged game %ld.\n", filename, *games);
+            ok = 0;
+            break;
+        }
+
+        // the stream follows the player table in keyframes that carry it
+        if (replay_u32(buf + body + 8) >= 3)
+        {
+            if (size < REPLAY_HEADER_BYTES + body + image_head + IMAGE_RNG_BYTES ||
+                !reserve(&buf, &cap, body + image_head + IMAGE_RNG_BYTES) ||
+                !read_exact(fp, buf + body + image_head, IMAGE_RNG_BYTES))
+            {
+                fprintf(stderr, "%s: truncated game %ld.\n", filename, *games);
+                ok = 0;
+                break;
+            }
+            stream = replay_u64(buf + body + image_head + 8);
+            image_head += IMAGE_RNG_BYTES;
+        }
+        for (p = 0; p < num_players; p++)
+        {
+            scores[p] = (int)replay_u32(buf + body + IMAGE_HEADER_BYTES + p * IMAGE_PLAYER_BYTES + 12);
+            inactive[p] = -1;
+        }
+
+        // decode the records once; the curves walk them again per seat
+        for (i = 0; i < count; i++)
+        {
+            uint32_t rec = replay_u32(buf + (size_t)keyframes * REPLAY_INDEX_BYTES + i * 4);
+            recs[i] = rec;
+            if (record_kind(rec) == REPLAY_INACTIVE)
+            {
+                if (inactive[record_player(rec)] < 0)
+                    inactive[record_player(rec)] = (int)t;
+                continue;
+            }
+            scores[record_player(rec)] += record_fish(rec);
+            t++;
+        }
+
+        printf("game %ld seed %llu stream %llu size %ux%u turns %u scores", *games,
+               (unsigned long long)replay_u64(h + 40), (unsigned long long)stream,
+               replay_u32(h + 16), replay_u32(h + 20), t);
+        for (p = 0; p < num_players; p++)
+            printf(" %d", scores[p]);
+        printf(" inactive");
+        for (p = 0; p < num_players; p++)
+        {
+            if (inactive[p] < 0) printf(" -");
+            else printf(" %d", inactive[p]);
+        }
+        printf("\n");
+
+        if (step > 0)
+        {
+            for (p = 0; p < num_players; p++)
+                print_curve(*games, p,
+                            (int)replay_u32(buf + body + IMAGE_HEADER_BYTES + p * IMAGE_PLAYER_BYTES + 12),
+                            recs, count, step);
+        }
+
+        if (!skip_bytes(fp, size - REPLAY_HEADER_BYTES - body - image_head))
+        {
+            fprintf(stderr, "%s: truncated game %ld.\n", filename, *games);
+            ok = 0;
+            break;
+        }
+        (*games)++;
+        *turns += t;
+        *bytes += size;
+    }
+
+    free(buf);
+    free(recs);
+    fclose(fp);
+    return ok;
+}
+
+// Apply one record of a block written in the given version to the position;
+// returns 0 if it is not legal there
+static int apply_record(Game *game, uint32_t rec, uint32_t version)
+{
+    Board *board = game->board;
+    int idx = record_player(rec);
+    uint32_t tile = record_tile(rec);
+    int pr, pc, tr, tc, id, from;
+
+    if (idx >= game->num_players || tile >= (uint32_t)board->rows * (uint32_t)board->cols)
+        return 0;
+    id = game->players[idx].id;
+    tr = (int)tile / board->cols;
+    tc = (int)tile % board->cols;
+
+    switch (record_kind(rec))
+    {
+        case REPLAY_PLACE:
+            if (game->players[idx].left <= 0 || board_fish(board, tr, tc) != 1 || board_owner(board, tr, tc) != 0)
+                return 0;
+            game_place_penguin(game, idx, tr, tc);
+            return 1;
+        case REPLAY_MOVE:
+            // version 1 games had one penguin each; later records say where the penguin came from
+            if (version < 2)
+            {
+                if (!find_penguin(board, id, &pr, &pc))
+                    return 0;
+            }
+            else
+            {
+                from = board_move_source(board, (int)tile, record_dir(rec));
+                if (from < 0 || from >= board->rows * board->cols ||
+                    board_move_dir(board, from, (int)tile) != record_dir(rec))
+                    return 0;
+                pr = from / board->cols;
+                pc = from % board->cols;
+                if (board_owner(board, pr, pc) != id)
+                    return 0;
+            }
+            if (!is_valid_move(board, id, pr, pc, tr, tc))
+                return 0;
+            game_make_move(game, idx, pr, pc, tr, tc);
+            return 1;
+        case REPLAY_INACTIVE:
+            game->active_flags[idx] = 0;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Print the position as plain text
+static void print_position(const Game *game)
+{
+    const Board *board = game->board;
+    int i, j;
+
+    for (i = 0; i < game->num_players; i++)
+        printf("Player %d (%s): score=%d%s\n", game->players[i].id, game->players[i].name,
+               game->players[i].score, game->active_flags[i] ? "" : " (inactive)");
+    printf("\n");
+    for (i = 0; i < board->rows; i++)
+    {
+        for (j = 0; j < board->cols; j++)
+        {
+            int fish = board_fish(board, i, j);
+            int owner = board_owner(board, i, j);
+            if (fish == 0 && owner == 0) printf("  -- ");
+            else printf(" %d(%d)", fish, owner);
+        }
+        printf("\n");
+    }
+}
+
+// Show the position after the given turn of one game, starting from its nearest keyframe
+static int seek(const char *filename, long game_no, long turn)
+{
+    FILE *fp = fopen(filename, "rb");
+    unsigned char h[REPLAY_HEADER_BYTES];
+    unsigned char *buf = NULL, *image = NULL;
+    size_t cap = 0;
+    uint32_t keyframes, count, rec_at, key_turn, t, i, k;
+    uint64_t image_size;
+    off_t start = 0;
+    int num_players, replayed = 0;
+    Game game;
+    long g;
+
+    if (!fp)
+    {
+        fprintf(stderr, "Cannot open %s.\n", filename);
+        return 0;
+    }
+
+    // hop from block to block using the sizes in the headers
+    for (g = 0; ; g++)
+    {
+        if (!read_exact(fp, h, sizeof(h)) || !check_header(h, &num_players))
+        {
+            fprintf(stderr, "%s: game %ld not found.\n", filename, game_no);
+            fclose(fp);
+            return 0;
+        }
+        if (g == game_no)
+            break;
+        start += (off_t)replay_u64(h + 48);
+        if (fseeko(fp, start, SEEK_SET) != 0)
+        {
+            fprintf(stderr, "%s: game %ld not found.\n", filename, game_no);
+            fclose(fp);
+            return 0;
+        }
+    }
+
+    // the last keyframe at or before the turn
+    keyframes = replay_u32(h + 28);
+    count = replay_u32(h + 32);
+    if (!reserve(&buf, &cap, (size_t)keyframes * REPLAY_INDEX_BYTES) ||
+        !read_exact(fp, buf, (size_t)keyframes * REPLAY_INDEX_BYTES))
+    {
+        fprintf(stderr, "%s: damaged game %ld.\n", filename, game_no);
+        free(buf);
+        fclose(fp);
+        return 0;
+    }
+    for (k = 0; k + 1 < keyframes && replay_u32(buf + (k + 1) * REPLAY_INDEX_BYTES) <= (uint32_t)turn; k++)
+        ;
+    key_turn = replay_u32(buf + k * REPLAY_INDEX_BYTES);
+    rec_at = replay_u32(buf + k * REPLAY_INDEX_BYTES + 4);
+
+    // load the keyframe image (it carries its own checksum)
+    if (fseeko(fp, start + (off_t)replay_u64(buf + k * REPLAY_INDEX_BYTES + 8), SEEK_SET) != 0 ||
+        !reserve(&buf, &cap, IMAGE_HEADER_BYTES) || !read_exact(fp, buf, IMAGE_HEADER_BYTES))
+    {
+        fprintf(stderr, "%s: damaged game %ld.\n", filename, game_no);
+        free(buf);
+        fclose(fp);
+        return 0;
+    }
+    image_size = IMAGE_HEADER_BYTES + replay_u64(buf + 48);
+    image = malloc((size_t)image_size);
+    if (image)
+        memcpy(image, buf, IMAGE_HEADER_BYTES);
+    if (!image || !read_exact(fp, image + IMAGE_HEADER_BYTES, (size_t)image_size - IMAGE_HEADER_BYTES) ||
+        !load_game_image(image, (size_t)image_size, &game))
+    {
+        fprintf(stderr, "%s: damaged keyframe in game %ld.\n", filename, game_no);
+        free(image);
+        free(buf);
+        fclose(fp);
+        return 0;
+    }
+    free(image);
+
+    // play the records after the keyframe up to the turn
+    if (fseeko(fp, start + REPLAY_HEADER_BYTES + (off_t)keyframes * REPLAY_INDEX_BYTES + (off_t)rec_at * 4,
+               SEEK_SET) != 0)
+        count = rec_at;
+    t = key_turn;
+    for (i = rec_at; i < count && t < (uint32_t)turn; i++)
+    {
+        unsigned char word[4];
+        uint32_t rec;
+        if (!read_exact(fp, word, 4))
+            break;
+        rec = replay_u32(word);
+        if (!apply_record(&game, rec, replay_u32(h + 8)))
+        {
+            fprintf(stderr, "%s: illegal record %u in game %ld.\n", filename, i, game_no);
+            break;
+        }
+        if (record_kind(rec) != REPLAY_INACTIVE)
+            t++;
+        replayed++;
+    }
+
+    printf("game %ld turn %u (keyframe at turn %u, %d records replayed)\n", game_no, t, key_turn, replayed);
+    print_position(&game);
+
+    free_board(game.board);
+    free(game.players);
+    free(buf);
+    fclose(fp);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    long game_no = -1, turn = -1, games = 0, turns = 0;
+    uint64_t bytes = 0;
+    int step = 0, ok = 1, i;
+    struct timespec t0, t1;
+    double elapsed;
+
+    // parse command line options; the rest are archive files
+    for (i = 1; i < argc && argv[i][0] == '-'; i++)
+    {
+        if (i + 1 >= argc) usage(argv[0]);
+        if (strcmp(argv[i], "-c") == 0) step = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-g") == 0) game_no = atol(argv[++i]);
+        else if (strcmp(argv[i], "-t") == 0) turn = atol(argv[++i]);
+        else usage(argv[0]);
+    }
+    if (i >= argc || step < 0)
+        usage(argv[0]);
+
+    if (game_no >= 0 || turn >= 0)
+    {
+        if (game_no < 0 || turn < 0 || i + 1 != argc)
+            usage(argv[0]);
+        return seek(argv[i], game_no, turn) ? 0 : 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (; i < argc; i++)
+        if (!summarize(argv[i], step, &games, &turns, &bytes))
+            ok = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    elapsed = (double)(t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    // totals go to stderr so the per-game lines stay easy to process
+    fprintf(stderr, "%ld games, %ld turns, %.1f MB in %.3f s (%.0f games/s)\n",
+            games, turns, bytes / 1e6, elapsed, elapsed > 0 ? games / elapsed : 0.0);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+/* This file seeds the xoshiro256** generator declared in rng.h.
+   The seed is expanded with splitmix64; a stream is hashed separately and
+   XORed into each state word. The hash maps stream 0 to 0, so stream 0 is
+   exactly the plain seed. */
+
+#include "rng.h"
+
+// Per-word odd multipliers that give each state word its own view of the stream
+static const uint64_t stream_mul[4] = {
+    0xD1B54A32D192ED03ULL, 0xAEF17502108EF2D9ULL, 0xDB4F0B9175AE2165ULL, 0x8CB92BA72F3D8DD7ULL
+};
+
+// Bijective 64-bit mix (the murmur3 finalizer); 0 stays 0
+static uint64_t mix64(uint64_t z)
+{
+    z = (z ^ (z >> 33)) * 0xFF51AFD7ED558CCDULL;
+    z = (z ^ (z >> 33)) * 0xC4CEB9FE1A85EC53ULL;
+    return z ^ (z >> 33);
+}
+
+// Expand a 64-bit seed into the full state with splitmix64
+void rng_seed(Rng *rng, uint64_t seed)
+{
+    rng_seed_stream(rng, seed, 0);
+}
+
+// Expand the seed, then fold in a different hash of the stream per word
+void rng_seed_stream(Rng *rng, uint64_t seed, uint64_t stream)
+{
+    int i;
+    for (i = 0; i < 4; i++)
+    {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        rng->s[i] = (z ^ (z >> 31)) ^ mix64(stream * stream_mul[i]);
+    }
+
+    // an all-zero state would only ever return zeros
+    if (!(rng->s[0] | rng->s[1] | rng->s[2] | rng->s[3]))
+        rng->s[0] = 0x9E3779B97F4A7C15ULL;
+}
@@ -0,0 +1,45 @@
+#ifndef RNG_H
+#define RNG_H
+
+// This header defines a small explicitly passed random number generator
+// (xoshiro256**). Every caller owns its state, so threads never share one.
+// A generator is named by a seed and a stream: equal pairs give equal
+// sequences, and different streams of one seed are independent, so workers
+// can each take their own stream without coordinating.
+
+#include <stdint.h>
+
+typedef struct {
+    uint64_t s[4];
+} Rng;
+
+// Seed the generator; equal seeds give equal sequences. Same as stream 0.
+void rng_seed(Rng *rng, uint64_t seed);
+
+// Seed the generator for one stream of a seed.
+void rng_seed_stream(Rng *rng, uint64_t seed, uint64_t stream);
+
+// Next 64 random bits.
+static inline uint64_t rng_next(Rng *rng)
+{
+    uint64_t *s = rng->s;
+    uint64_t x = s[1] * 5;
+    uint64_t result = ((x << 7) | (x >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
+// Random integer in [0, n) for small n.
+static inline int rng_below(Rng *rng, int n)
+{
+    return (int)(((rng_next(rng) >> 32) * (uint64_t)n) >> 32);
+}
+
+#endif
@@ -0,0 +1,281 @@
+/*
+ * Board-size scaling benchmark for Penguins Game.
+ * For each board size it builds and fills a board, then plays one headless
+ * greedy game turn by turn through game_place_penguin / game_make_move, timing
+ * every placement and move on its own. It reports the board's memory, the
+ * process's peak resident size, the time to fill the board, to take a
+ * snapshot (the V2 image autosave writes) and to load it back, and the
+ * per-turn latency distribution, so a turn cost that grows with the board
+ * area shows up at once.
+ *
+ * Usage: penguin-scale [-p players] [-s seed] [-S stream] [-m max-turns]
+ *                      [-k scalar|sse2|avx2] [-l 0|1] [size...]
+ * A size is N (an NxN board) or ROWSxCOLS; the default sizes run from 16x16
+ * to 4096x4096. -k caps the scan kernels (see scan.h) to compare them, and
+ * -l 1 places the penguins with the placement evaluator (placement.h)
+ * instead of on the first free tile.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "board.h"
+#include "players.h"
+#include "game.h"
+#include "rng.h"
+#include "scan.h"
+#include "placement.h"
+
+// Turns timed per board unless -m says otherwise
+#define SCALE_MAX_TURNS 200000
+
+static const char *default_sizes[] = { "16", "64", "256", "1024", "2048", "4096" };
+
+// Print usage and exit
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-p players 2-%d] [-s seed] [-S stream] [-m max-turns]\n"
+                    "       [-k scalar|sse2|avx2] [-l 0|1] [size...]\n"
+                    "size: N or ROWSxCOLS, sides 1-%d\n", prog, MAX_PLAYERS, BOARD_MAX_SIDE);
+    exit(1);
+}
+
+// Monotonic time in nanoseconds
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Peak resident set size of the process in MB
+static double peak_rss_mb(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss / 1024.0;
+}
+
+// Read N or ROWSxCOLS
+static int parse_size(const char *arg, int *rows, int *cols)
+{
+    char tail;
+    if (sscanf(arg, "%dx%d%c", rows, cols, &tail) != 2)
+    {
+        if (sscanf(arg, "%d%c", rows, &tail) != 1)
+            return 0;
+        *cols = *rows;
+    }
+    return *rows >= 1 && *rows <= BOARD_MAX_SIDE && *cols >= 1 && *cols <= BOARD_MAX_SIDE;
+}
+
+// Read a scan kernel level by name
+static int parse_level(const char *arg)
+{
+    int level;
+    for (level = SCAN_SCALAR; level <= SCAN_AVX2; level++)
+        if (strcmp(arg, scan_level_name(level)) == 0)
+            return level;
+    return -1;
+}
+
+// Sort helper for turn times
+static int cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Play one greedy game the way movement_phase does, timing each turn into times[].
+// Penguins go where the evaluator says if there is one. Returns the number of turns played.
+static long play_timed(Game *game, Placement *placement, long long *times, long max_turns)
+{
+    Board *board = game->board;
+    Player *players = game->players;
+    int n = game->num_players;
+    long turns = 0;
+    int p, r, c, active = n, moved = 1;
+    Move m;
+
+    // placement: one round-robin pass per penguin
+    while (turns < max_turns && can_place(board) && moved)
+    {
+        moved = 0;
+        for (p = 0; p < n && turns < max_turns; p++)
+        {
+            long long t0;
+            if (players[p].left == 0)
+                continue;
+            t0 = now_ns();
+            if (placement ? !placement_choose(placement, board, &r, &c)
+                          : !find_first_placement(board, &r, &c))
+                break;
+            game_place_penguin(game, p, r, c);
+            times[turns++] = now_ns() - t0;
+            moved = 1;
+        }
+    }
+
+    // movement until nobody can move
+    while (turns < max_turns && active > 0)
+    {
+        active = 0;
+        for (p = 0; p < n && turns < max_turns; p++)
+        {
+            long long t0;
+            if (!game->active_flags[p])
+                continue;
+            t0 = now_ns();
+            if (!player_can_move(board, players[p].id) ||
+                !find_best_adjacent_move(board, players[p].id, &m))
+            {
+                game->active_flags[p] = 0;
+                continue;
+            }
+            game_make_move(game, p, m.from / board->cols, m.from % board->cols,
+                           m.to / board->cols, m.to % board->cols);
+            times[turns++] = now_ns() - t0;
+            active++;
+        }
+    }
+    return turns;
+}
+
+// Measure one board size and print its row of the report
+static int run_size(int rows, int cols, int num_players, uint64_t seed, uint64_t stream, long max_turns,
+                    Placement *placement)
+{
+    Player players[MAX_PLAYERS];
+    long long *times = malloc((size_t)max_turns * sizeof(long long));
+    long long t0, init_ns, snap_ns, load_ns, sum = 0;
+    unsigned char *image;
+    size_t image_size;
+    Board *board;
+    Game game, loaded;
+    Rng rng;
+    long turns, i;
+
+    t0 = now_ns();
+    board = create_board(rows, cols);
+    if (!board || !times)
+    {
+        free(times);
+        free_board(board);
+        return 0;
+    }
+    rng_seed_stream(&rng, seed, stream);
+    init_board(board, &rng);
+    init_ns = now_ns() - t0;
+
+    memset(players, 0, sizeof(players));
+    for (i = 0; i < num_players; i++)
+    {
+        players[i].is_ai = AI_GREEDY;
+        snprintf(players[i].name, sizeof(players[i].name), "AI%ld", i + 1);
+    }
+    reset_players(players, num_players, 1);
+    init_game(&game, board, players, num_players, MODE_PVP);
+    game.quiet = 1;
+
+    turns = play_timed(&game, placement, times, max_turns);
+
+    // the snapshot autosave and replays take of the finished position
+    t0 = now_ns();
+    image = save_game_image(&game, &image_size);
+    snap_ns = now_ns() - t0;
+
+    // and loading it back, which rebuilds the planes from the tiles
+    t0 = now_ns();
+    if (!image || !load_game_image(image, image_size, &loaded))
+    {
+        free(image);
+        free(times);
+        free_board(board);
+        return 0;
+    }
+    load_ns = now_ns() - t0;
+    free_board(loaded.board);
+    free(loaded.players);
+    free(image);
+
+    qsort(times, (size_t)turns, sizeof(long long), cmp_ll);
+    for (i = 0; i < turns; i++)
+        sum += times[i];
+
+    printf("%5dx%-5d %9.2f %8.1f %8.1f %8.2f %8.2f %8ld %8.0f %7lld %7lld %8lld\n",
+           rows, cols, board_bytes(rows, cols) / 1e6, peak_rss_mb(), init_ns / 1e6, snap_ns / 1e6,
+           load_ns / 1e6,
+           turns, turns ? (double)sum / turns : 0.0,
+           turns ? times[turns / 2] : 0, turns ? times[turns * 99 / 100] : 0, turns ? times[turns - 1] : 0);
+    fflush(stdout);
+
+    free(times);
+    free_board(board);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    int num_players = 4, rows, cols, i;
+    uint64_t seed = 1, stream = 0;
+    long max_turns = SCALE_MAX_TURNS;
+    const char **sizes = default_sizes;
+    Placement *placement = NULL;
+    int smart = 0;
+    int num_sizes = (int)(sizeof(default_sizes) / sizeof(default_sizes[0]));
+
+    // parse command line options; the rest are board sizes
+    for (i = 1; i < argc && argv[i][0] == '-'; i++)
+    {
+        if (i + 1 >= argc) usage(argv[0]);
+        if (strcmp(argv[i], "-p") == 0) num_players = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0) seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-S") == 0) stream = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-m") == 0) max_turns = atol(argv[++i]);
+        else if (strcmp(argv[i], "-l") == 0) smart = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-k") == 0)
+        {
+            int level = parse_level(argv[++i]);
+            if (level < 0) usage(argv[0]);
+            scan_set_level(level);
+        }
+        else usage(argv[0]);
+    }
+    if (num_players < 2 || num_players > MAX_PLAYERS || max_turns < 1)
+        usage(argv[0]);
+    if (i < argc)
+    {
+        sizes = (const char **)(argv + i);
+        num_sizes = argc - i;
+    }
+    for (i = 0; i < num_sizes; i++)
+        if (!parse_size(sizes[i], &rows, &cols))
+            usage(argv[0]);
+
+    if (smart && !(placement = placement_create()))
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return 1;
+    }
+
+    printf("%d greedy players, %s placement, seed %llu stream %llu, %s scan kernels, per-turn times in ns\n\n",
+           num_players, placement ? "evaluated" : "first-tile", (unsigned long long)seed,
+           (unsigned long long)stream, scan_level_name(scan_level()));
+    printf("board        board(MB) rss(MB) init(ms) snap(ms) load(ms)    turns     mean     p50     p99      max\n");
+    for (i = 0; i < num_sizes; i++)
+    {
+        parse_size(sizes[i], &rows, &cols);
+        if (!run_size(rows, cols, num_players, seed, stream, max_turns, placement))
+        {
+            fprintf(stderr, "Memory allocation failed.\n");
+            placement_free(placement);
+            return 1;
+        }
+    }
+    placement_free(placement);
+    return 0;
+}
@@ -0,0 +1,287 @@
+/* This file implements the scan kernels declared in scan.h.
+   The SSE2 and AVX2 versions compare 16 or 32 tiles per instruction and
+   turn the answers into plane bits with movemask; they are compiled with
+   per-function target attributes, so the program itself needs no -mavx2
+   and still runs on CPUs without AVX2. Anything that is not x86 with GCC
+   or Clang builds only the scalar kernels. Tail tiles and words that do
+   not fill a vector go through the scalar code. */
+
+#include <stdatomic.h>
+#include "scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define SCAN_X86 1
+#include <immintrin.h>
+#else
+#define SCAN_X86 0
+#endif
+
+#ifdef BOARD_VERIFY
+#include <assert.h>
+#endif
+
+// Tile fields as laid out in board.h
+#define FISH_BITS  0x03
+#define OWNER_BITS 0x1C
+
+// Highest level scan_set_level allows
+static int level_cap = SCAN_AVX2;
+
+// Best level the CPU supports, -1 until first asked; engine threads may ask at once
+static _Atomic int cpu_best = -1;
+
+// Best level the CPU supports
+static int cpu_level(void)
+{
+#if SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SCAN_AVX2;
+    return SCAN_SSE2;
+#else
+    return SCAN_SCALAR;
+#endif
+}
+
+// Detect the CPU once; every kernel call after that costs a load and a compare
+int scan_level(void)
+{
+    int level = atomic_load_explicit(&cpu_best, memory_order_relaxed);
+    if (level < 0)
+    {
+        level = cpu_level();
+        atomic_store_explicit(&cpu_best, level, memory_order_relaxed);
+    }
+    return level < level_cap ? level : level_cap;
+}
+
+int scan_set_level(int level)
+{
+    level_cap = level < SCAN_SCALAR ? SCAN_SCALAR : level;
+    return scan_level();
+}
+
+const char *scan_level_name(int level)
+{
+    static const char *names[] = { "scalar", "sse2", "avx2" };
+    return level >= SCAN_SCALAR && level <= SCAN_AVX2 ? names[level] : "?";
+}
+
+// OR the low k bits of m into a plane at bit index bit (k <= 64)
+static void put_bits(uint64_t *plane, int bit, uint64_t m, int k)
+{
+    int s = bit & 63;
+    plane[bit >> 6] |= m << s;
+    if (s && s + k > 64)
+        plane[(bit >> 6) + 1] |= m >> (64 - s);
+}
+
+// Number of set bits
+static int count_bits(uint64_t x)
+{
+    return __builtin_popcountll(x);
+}
+
+// Scalar packing, up to 64 tiles per plane write
+static int pack_scalar(const unsigned char *tiles, int n, uint64_t *ice, uint64_t *occupied,
+                       uint64_t *one_fish, int bit)
+{
+    int i, placeable = 0;
+
+    for (i = 0; i < n; i += 64)
+    {
+        int k = n - i < 64 ? n - i : 64;
+        uint64_t m_ice = 0, m_occ = 0, m_one = 0;
+        int j;
+
+        for (j = 0; j < k; j++)
+        {
+            unsigned char t = tiles[i + j];
+            m_ice |= (uint64_t)(t != 0) << j;
+            m_occ |= (uint64_t)((t & OWNER_BITS) != 0) << j;
+            m_one |= (uint64_t)((t & FISH_BITS) == 1) << j;
+        }
+        put_bits(ice, bit + i, m_ice, k);
+        put_bits(occupied, bit + i, m_occ, k);
+        put_bits(one_fish, bit + i, m_one, k);
+        placeable += count_bits(m_one & ~m_occ);
+    }
+    return placeable;
+}
+
+// Scalar search, one word at a time
+static int first_andnot_scalar(const uint64_t *a, const uint64_t *b, int from, int words)
+{
+    int w;
+    for (w = from; w < words; w++)
+    {
+        uint64_t m = a[w] & ~b[w];
+        if (m)
+            return w * 64 + __builtin_ctzll(m);
+    }
+    return -1;
+}
+
+#if SCAN_X86
+// SSE2 packing: four 16-tile compares make one 64-bit plane write
+__attribute__((target("sse2")))
+static int pack_sse2(const unsigned char *tiles, int n, uint64_t *ice, uint64_t *occupied,
+                     uint64_t *one_fish, int bit)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i fish_bits = _mm_set1_epi8(FISH_BITS);
+    const __m128i owner_bits = _mm_set1_epi8(OWNER_BITS);
+    const __m128i one = _mm_set1_epi8(1);
+    int i, j, placeable = 0;
+
+    for (i = 0; i + 64 <= n; i += 64)
+    {
+        uint64_t m_water = 0, m_free = 0, m_one = 0;
+        for (j = 0; j < 64; j += 16)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(tiles + i + j));
+            m_water |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) << j;
+            m_free |= (uint64_t)(unsigned)_mm_movemask_epi8(
+                          _mm_cmpeq_epi8(_mm_and_si128(v, owner_bits), zero)) << j;
+            m_one |= (uint64_t)(unsigned)_mm_movemask_epi8(
+                         _mm_cmpeq_epi8(_mm_and_si128(v, fish_bits), one)) << j;
+        }
+        put_bits(ice, bit + i, ~m_water, 64);
+        put_bits(occupied, bit + i, ~m_free, 64);
+        put_bits(one_fish, bit + i, m_one, 64);
+        placeable += count_bits(m_one & m_free);
+    }
+    return placeable + pack_scalar(tiles + i, n - i, ice, occupied, one_fish, bit + i);
+}
+
+// AVX2 packing: two 32-tile compares make one 64-bit plane write
+__attribute__((target("avx2")))
+static int pack_avx2(const unsigned char *tiles, int n, uint64_t *ice, uint64_t *occupied,
+                     uint64_t *one_fish, int bit)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i fish_bits = _mm256_set1_epi8(FISH_BITS);
+    const __m256i owner_bits = _mm256_set1_epi8(OWNER_BITS);
+    const __m256i one = _mm256_set1_epi8(1);
+    int i, j, placeable = 0;
+
+    for (i = 0; i + 64 <= n; i += 64)
+    {
+        uint64_t m_water = 0, m_free = 0, m_one = 0;
+        for (j = 0; j < 64; j += 32)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(tiles + i + j));
+            m_water |= (uint64_t)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero)) << j;
+            m_free |= (uint64_t)(unsigned)_mm256_movemask_epi8(
+                          _mm256_cmpeq_epi8(_mm256_and_si256(v, owner_bits), zero)) << j;
+            m_one |= (uint64_t)(unsigned)_mm256_movemask_epi8(
+                         _mm256_cmpeq_epi8(_mm256_and_si256(v, fish_bits), one)) << j;
+        }
+        put_bits(ice, bit + i, ~m_water, 64);
+        put_bits(occupied, bit + i, ~m_free, 64);
+        put_bits(one_fish, bit + i, m_one, 64);
+        placeable += count_bits(m_one & m_free);
+    }
+    return placeable + pack_scalar(tiles + i, n - i, ice, occupied, one_fish, bit + i);
+}
+
+// SSE2 search, two words per test
+__attribute__((target("sse2")))
+static int first_andnot_sse2(const uint64_t *a, const uint64_t *b, int words)
+{
+    int w;
+    for (w = 0; w + 2 <= words; w += 2)
+    {
+        __m128i m = _mm_andnot_si128(_mm_loadu_si128((const __m128i *)(b + w)),
+                                     _mm_loadu_si128((const __m128i *)(a + w)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(m, _mm_setzero_si128())) != 0xFFFF)
+            break;
+    }
+    return first_andnot_scalar(a, b, w, words);
+}
+
+// AVX2 search, four words per test
+__attribute__((target("avx2")))
+static int first_andnot_avx2(const uint64_t *a, const uint64_t *b, int words)
+{
+    int w;
+    for (w = 0; w + 4 <= words; w += 4)
+    {
+        __m256i m = _mm256_andnot_si256(_mm256_loadu_si256((const __m256i *)(b + w)),
+                                        _mm256_loadu_si256((const __m256i *)(a + w)));
+        if (!_mm256_testz_si256(m, m))
+            break;
+    }
+    return first_andnot_scalar(a, b, w, words);
+}
+#endif
+
+#ifdef BOARD_VERIFY
+// Reference check of packed planes: every tile's three bits and the placeable count
+static void verify_pack(const unsigned char *tiles, int n, const uint64_t *ice, const uint64_t *occupied,
+                        const uint64_t *one_fish, int bit, int placeable)
+{
+    int i, count = 0;
+    for (i = 0; i < n; i++)
+    {
+        unsigned char t = tiles[i];
+        int at = bit + i;
+        assert((int)((ice[at >> 6] >> (at & 63)) & 1) == (t != 0));
+        assert((int)((occupied[at >> 6] >> (at & 63)) & 1) == ((t & OWNER_BITS) != 0));
+        assert((int)((one_fish[at >> 6] >> (at & 63)) & 1) == ((t & FISH_BITS) == 1));
+        count += t == 1;
+    }
+    assert(count == placeable);
+}
+#endif
+
+// Pack with the best kernel available
+int scan_pack_tiles(const unsigned char *tiles, int n, uint64_t *ice, uint64_t *occupied,
+                    uint64_t *one_fish, int bit)
+{
+    int placeable;
+
+    switch (scan_level())
+    {
+#if SCAN_X86
+    case SCAN_AVX2:
+        placeable = pack_avx2(tiles, n, ice, occupied, one_fish, bit);
+        break;
+    case SCAN_SSE2:
+        placeable = pack_sse2(tiles, n, ice, occupied, one_fish, bit);
+        break;
+#endif
+    default:
+        placeable = pack_scalar(tiles, n, ice, occupied, one_fish, bit);
+        break;
+    }
+#ifdef BOARD_VERIFY
+    verify_pack(tiles, n, ice, occupied, one_fish, bit, placeable);
+#endif
+    return placeable;
+}
+
+// Search with the best kernel available
+int scan_first_andnot(const uint64_t *a, const uint64_t *b, int words)
+{
+    int found;
+
+    switch (scan_level())
+    {
+#if SCAN_X86
+    case SCAN_AVX2:
+        found = first_andnot_avx2(a, b, words);
+        break;
+    case SCAN_SSE2:
+        found = first_andnot_sse2(a, b, words);
+        break;
+#endif
+    default:
+        found = first_andnot_scalar(a, b, 0, words);
+        break;
+    }
+#ifdef BOARD_VERIFY
+    assert(found == first_andnot_scalar(a, b, 0, words));
+#endif
+    return found;
+}
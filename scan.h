@@ -0,0 +1,36 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+// This header declares the bulk scan kernels behind the board's plane
+// rebuild and placement search. Each kernel has a scalar, an SSE2 and an
+// AVX2 version; the fastest one the CPU supports is picked at run time, and
+// a -DBOARD_VERIFY build checks every vector answer against the scalar one.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Kernel levels, slowest first.
+#define SCAN_SCALAR 0
+#define SCAN_SSE2   1
+#define SCAN_AVX2   2
+
+// Level the kernels run at: the best the CPU supports, or lower if scan_set_level asked for it.
+int scan_level(void);
+
+// Cap the level (to compare kernels); call before any threads start. Returns the level now in use.
+int scan_set_level(int level);
+
+// Name of a level ("scalar", "sse2", "avx2").
+const char *scan_level_name(int level);
+
+// Pack n tiles (the byte layout of board.h) into three bit planes starting
+// at bit index bit: ice (not water), occupied (has an owner) and one_fish
+// (exactly 1 fish). Bits are ORed in, so the planes must start cleared.
+// Returns the number of placeable tiles (1 fish, no owner) among them.
+int scan_pack_tiles(const unsigned char *tiles, int n, uint64_t *ice, uint64_t *occupied,
+                    uint64_t *one_fish, int bit);
+
+// Index of the first bit set in a & ~b over the first words 64-bit words, or -1.
+int scan_first_andnot(const uint64_t *a, const uint64_t *b, int words);
+
+#endif
@@ -0,0 +1,508 @@
+/* This file implements the alpha-beta search AI declared in search.h.
+   Iterative deepening runs depth 1, 2, ... until the depth or time limit, and
+   each iteration tries the previous best move first. Every position is scored
+   from the point of view of the searching ("root") player: fish it collects
+   count (n-1) times, fish any opponent collects count -1 times, so the root
+   maximizes and all opponents together minimize. Scores in the tree are the
+   fish still to be collected from that position on, so a cached value does not
+   depend on how the position was reached. The whole tree is walked on one
+   working board: each move is played with make_move and taken back with
+   unmake_move, so nothing is copied or allocated per node.
+
+   With several threads the search is "lazy SMP": thread 0 runs the iterative
+   deepening that picks the move, and every other thread searches the same
+   root on its own board, odd threads one ply deeper and each with its root
+   moves rotated, until thread 0 is done. The threads share nothing but the
+   transposition table, which they read and write without locks: an entry is
+   two 64-bit words, the packed data and the key XORed with it, so a lookup
+   that races a store sees a key that does not match and treats it as a miss. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "search.h"
+
+// One collected fish is worth this many evaluation units; leaf heuristics use smaller steps.
+#define FISH_UNIT 4
+#define INF 1000000
+
+// Transposition table bound types.
+#define TT_EXACT 0
+#define TT_LOWER 1
+#define TT_UPPER 2
+
+// One transposition table slot: data packed as below, and check = key ^ data.
+// An empty slot (both 0) reads as key 0.
+typedef struct {
+    _Atomic uint64_t check;
+    _Atomic uint64_t data;
+} TTEntry;
+
+// One slot, unpacked.
+typedef struct {
+    int value;      // score within the stored bound
+    int move;       // best move found: from * 4 + direction, -1 if none
+    int depth;      // remaining depth the value was searched to
+    int flag;       // TT_EXACT, TT_LOWER or TT_UPPER
+    int cut;        // some line below was cut off by depth
+} TTData;
+
+// Everything one thread touches while it searches.
+typedef struct {
+    struct Search *search;
+    int id;            // 0 picks the move, the others help
+    Board *board;      // working copy of the board, moved and unmoved in place
+    int stopped;       // time ran out or thread 0 is done; this iteration is discarded
+    int horizon;       // some line was cut off by depth, so a deeper search may differ
+    int root_move;     // best root move of the current iteration
+    int depth;         // deepest iteration finished
+    long nodes, tt_probes, tt_hits;
+    char pad[64];      // keeps the counters of neighbouring threads off each other's cache lines
+} SearchWorker;
+
+struct Search {
+    TTEntry *tt;
+    uint64_t tt_mask;
+    SearchWorker workers[SEARCH_MAX_THREADS];
+    int num_threads;
+    int rows, cols;    // size the working boards were made for
+    int max_depth;
+    int time_ms;
+
+    // the decision in progress, read-only for the workers
+    const Board *root_board;
+    int root;          // player the move is being chosen for
+    int num_players;
+    double deadline;
+    _Atomic int done;  // thread 0 has finished; helpers stop
+    _Atomic int stop;  // set from outside by search_set_stop
+
+    SearchStats last;
+    SearchStats total;
+};
+
+// Seconds on a monotonic clock
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Key mixed into the board hash for the player to move and the searching player
+static uint64_t side_key(int mover, int root)
+{
+    static const uint64_t keys[MAX_PLAYERS + 1] = {
+        0, 0x8A5CD789635D2DFFULL, 0x121FD2155C472F96ULL,
+        0x0F3A6F3D3E5B8C21ULL, 0x5E47C3DE9B0A7F14ULL
+    };
+    return keys[mover] ^ (keys[root] * 0x9E3779B97F4A7C15ULL);
+}
+
+// Pack a slot: value in the low 24 bits, move + 1 in the next 27, depth in 7, the flag in 2 and the cut bit
+static uint64_t tt_pack(int value, int move, int depth, int flag, int cut)
+{
+    return ((uint64_t)(uint32_t)value & 0xFFFFFF) | (uint64_t)(move + 1) << 24 |
+           (uint64_t)depth << 51 | (uint64_t)flag << 58 | (uint64_t)cut << 60;
+}
+
+// Unpack a slot's data
+static TTData tt_unpack(uint64_t data)
+{
+    TTData d;
+    d.value = (int)(data & 0xFFFFFF) - (int)(data << 1 & 0x1000000);   // sign-extend 24 bits
+    d.move = (int)(data >> 24 & 0x7FFFFFF) - 1;
+    d.depth = (int)(data >> 51 & 0x7F);
+    d.flag = (int)(data >> 58 & 0x3);
+    d.cut = (int)(data >> 60 & 0x1);
+    return d;
+}
+
+// Read a slot; returns 1 if it holds the position with this key
+static int tt_read(const TTEntry *entry, uint64_t key, TTData *out)
+{
+    uint64_t data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+    uint64_t check = atomic_load_explicit(&entry->check, memory_order_relaxed);
+
+    *out = tt_unpack(data);
+    return (check ^ data) == key;
+}
+
+// Write a slot
+static void tt_write(TTEntry *entry, uint64_t key, uint64_t data)
+{
+    atomic_store_explicit(&entry->data, data, memory_order_relaxed);
+    atomic_store_explicit(&entry->check, key ^ data, memory_order_relaxed);
+}
+
+// Create a searcher with an empty transposition table and one thread
+Search *search_create(int tt_bits)
+{
+    Search *search = calloc(1, sizeof(Search));
+    int i;
+    if (!search) return NULL;
+
+    if (tt_bits < 10) tt_bits = 10;
+    search->tt = calloc((size_t)1 << tt_bits, sizeof(TTEntry));
+    if (!search->tt)
+    {
+        free(search);
+        return NULL;
+    }
+    search->tt_mask = ((uint64_t)1 << tt_bits) - 1;
+    search->num_threads = 1;
+    search->max_depth = 8;
+    search->time_ms = 0;
+    for (i = 0; i < SEARCH_MAX_THREADS; i++)
+    {
+        search->workers[i].search = search;
+        search->workers[i].id = i;
+    }
+    return search;
+}
+
+// Free the searcher and everything it owns
+void search_free(Search *search)
+{
+    int i;
+    if (!search) return;
+    for (i = 0; i < SEARCH_MAX_THREADS; i++)
+        free_board(search->workers[i].board);
+    free(search->tt);
+    free(search);
+}
+
+// Set the thread count; 0 = one per CPU
+void search_set_threads(Search *search, int threads)
+{
+    if (threads <= 0)
+    {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = n > 0 ? (int)n : 1;
+    }
+    if (threads > SEARCH_MAX_THREADS) threads = SEARCH_MAX_THREADS;
+    search->num_threads = threads;
+}
+
+// Set the iterative deepening limits
+void search_set_limits(Search *search, int max_depth, int time_ms)
+{
+    if (max_depth < 1) max_depth = 1;
+    if (max_depth > SEARCH_MAX_PLY) max_depth = SEARCH_MAX_PLY;
+    search->max_depth = max_depth;
+    search->time_ms = time_ms > 0 ? time_ms : 0;
+}
+
+// Raise or clear the stop flag thread 0 polls with the clock
+void search_set_stop(Search *search, int stop)
+{
+    atomic_store(&search->stop, stop);
+}
+
+// Make sure every thread's working board has this board's size
+static int ensure_boards(Search *search, const Board *board)
+{
+    int i;
+
+    if (search->rows != board->rows || search->cols != board->cols)
+    {
+        for (i = 0; i < SEARCH_MAX_THREADS; i++)
+        {
+            free_board(search->workers[i].board);
+            search->workers[i].board = NULL;
+        }
+        search->rows = board->rows;
+        search->cols = board->cols;
+    }
+    for (i = 0; i < search->num_threads; i++)
+    {
+        if (search->workers[i].board)
+            continue;
+        search->workers[i].board = create_board(board->rows, board->cols);
+        if (!search->workers[i].board)
+            return 0;
+    }
+    return 1;
+}
+
+// Weight of one unit collected by player p, from the root player's point of view
+static int weight(const Search *s, int p)
+{
+    return p == s->root ? s->num_players - 1 : -1;
+}
+
+// Put the cached best move first, then order by fish on the destination, most first
+static void order_moves(Move *moves, int n, int tt_move)
+{
+    int i, j;
+    for (i = 1; i < n; i++)
+    {
+        Move m = moves[i];
+        int key = (m.from * 4 + m.dir == tt_move) ? 100 : m.fish;
+        for (j = i - 1; j >= 0; j--)
+        {
+            int kj = (moves[j].from * 4 + moves[j].dir == tt_move) ? 100 : moves[j].fish;
+            if (kj >= key) break;
+            moves[j + 1] = moves[j];
+        }
+        moves[j + 1] = m;
+    }
+}
+
+// Rotate moves[first..n-1] left by shift places, so a helper thread tries its root moves in another order
+static void rotate_moves(Move *moves, int n, int first, int shift)
+{
+    Move tmp[MAX_MOVES];
+    int i, len = n - first;
+
+    if (len < 2 || shift % len == 0)
+        return;
+    for (i = 0; i < len; i++)
+        tmp[i] = moves[first + (i + shift) % len];
+    memcpy(moves + first, tmp, len * sizeof(Move));
+}
+
+// Leaf estimate: best next catch and number of free neighbours of every penguin
+static int evaluate(const Search *s, const Board *b)
+{
+    int p, value = 0;
+    for (p = 1; p <= s->num_players; p++)
+    {
+        Move moves[MAX_MOVES];
+        int n = board_gen_moves(b, p, moves);
+        int i, best = 0;
+        for (i = 0; i < n; i++)
+            if (moves[i].fish > best) best = moves[i].fish;
+        value += weight(s, p) * (2 * best + n);
+    }
+    return value;
+}
+
+// Alpha-beta over the remaining fish; side is the first player to consider for the next move
+static int alpha_beta(SearchWorker *w, int ply, int depth, int side, int alpha, int beta)
+{
+    Search *s = w->search;
+    Board *b = w->board;
+    TTEntry *entry;
+    TTData tt;
+    Move moves[MAX_MOVES];
+    uint64_t key;
+    int mover, n, i, maximizing, found, outer_horizon, cut;
+    int alpha0 = alpha, beta0 = beta;
+    int best, best_move = -1, tt_move = -1;
+
+    // thread 0 watches the clock and the stop flag, helpers watch thread 0
+    w->nodes++;
+    if ((w->nodes & 2047) == 0 &&
+        (w->id == 0 ? (s->time_ms > 0 && w->depth > 0 && now_seconds() > s->deadline) ||
+                      atomic_load_explicit(&s->stop, memory_order_relaxed)
+                    : atomic_load_explicit(&s->done, memory_order_relaxed)))
+        w->stopped = 1;
+    if (w->stopped)
+        return 0;
+
+    mover = board_next_mover(b, s->num_players, side);
+    if (!mover)
+        return 0;   // nobody can move: no more fish will be collected
+    if (depth == 0 || ply == SEARCH_MAX_PLY)
+    {
+        w->horizon = 1;
+        return evaluate(s, b);
+    }
+
+    key = b->hash ^ side_key(mover, s->root);
+    entry = &s->tt[key & s->tt_mask];
+    w->tt_probes++;
+    found = tt_read(entry, key, &tt);
+    if (found)
+    {
+        w->tt_hits++;
+        tt_move = tt.move;
+        // a cached value whose tree was cut off by depth still leaves a horizon
+        if (ply > 0 && tt.depth >= depth &&
+            (tt.flag == TT_EXACT || (tt.flag == TT_LOWER && tt.value >= beta) ||
+             (tt.flag == TT_UPPER && tt.value <= alpha)))
+        {
+            w->horizon |= tt.cut;
+            return tt.value;
+        }
+    }
+
+    n = board_gen_moves(b, mover, moves);
+    order_moves(moves, n, tt_move);
+    if (ply == 0 && w->id > 0)
+        rotate_moves(moves, n, tt_move >= 0, w->id);
+
+    maximizing = (mover == s->root);
+    best = maximizing ? -INF : INF;
+
+    // note whether this subtree meets a horizon, for its table entry
+    outer_horizon = w->horizon;
+    w->horizon = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        int gain = FISH_UNIT * moves[i].fish * weight(s, mover);
+        MoveDelta delta;
+        int v;
+
+        make_move(b, mover, moves[i].from, moves[i].to, &delta);
+        v = gain + alpha_beta(w, ply + 1, depth - 1, mover % s->num_players + 1,
+                              alpha - gain, beta - gain);
+        unmake_move(b, &delta);
+        if (w->stopped)
+            return 0;
+
+        if (maximizing ? v > best : v < best)
+        {
+            best = v;
+            best_move = moves[i].from * 4 + moves[i].dir;
+        }
+        if (maximizing && best > alpha) alpha = best;
+        if (!maximizing && best < beta) beta = best;
+        if (alpha >= beta)
+            break;
+    }
+
+    if (ply == 0)
+        w->root_move = best_move;
+    cut = w->horizon;
+    w->horizon |= outer_horizon;
+
+    // replace slots holding another position, or the same one searched less deep
+    if (!found || depth >= tt.depth)
+        tt_write(entry, key, tt_pack(best, best_move, depth,
+                                     best <= alpha0 ? TT_UPPER : best >= beta0 ? TT_LOWER : TT_EXACT, cut));
+    return best;
+}
+
+// Reset a thread's board and counters for a new decision
+static void worker_start(SearchWorker *w)
+{
+    board_copy(w->board, w->search->root_board);
+    w->stopped = 0;
+    w->depth = 0;
+    w->nodes = w->tt_probes = w->tt_hits = 0;
+}
+
+// Helper thread body: deepen from the root, odd threads a ply ahead, until thread 0 is done
+static void *helper_run(void *arg)
+{
+    SearchWorker *w = (SearchWorker *)arg;
+    Search *s = w->search;
+    int depth;
+
+    worker_start(w);
+    for (depth = 1 + (w->id & 1); depth <= s->max_depth + 1 && depth <= SEARCH_MAX_PLY; depth++)
+    {
+        w->horizon = 0;
+        alpha_beta(w, 0, depth, s->root, -INF, INF);
+        if (w->stopped)
+            break;
+        w->depth = depth;
+        if (!w->horizon)
+            break;
+    }
+    return NULL;
+}
+
+// Pick the best move for player_id by iterative deepening, with helper threads if there are any
+int search_best_move(Search *search, const Board *board, int num_players, int player_id, Move *move)
+{
+    pthread_t threads[SEARCH_MAX_THREADS];
+    int started[SEARCH_MAX_THREADS] = { 0 };
+    SearchWorker *main_worker = &search->workers[0];
+    Move moves[MAX_MOVES];
+    double start = now_seconds();
+    int best_move = -1, used_threads = 1;
+    int depth, i, n;
+
+    memset(&search->last, 0, sizeof(search->last));
+
+    n = board_gen_moves(board, player_id, moves);
+    if (n == 0 || !ensure_boards(search, board))
+        return 0;
+
+    // fall back to the greedy choice if not even depth 1 finishes
+    order_moves(moves, n, -1);
+    best_move = moves[0].from * 4 + moves[0].dir;
+
+    search->root_board = board;
+    search->root = player_id;
+    search->num_players = num_players;
+    search->deadline = start + search->time_ms / 1000.0;
+    atomic_store(&search->done, 0);
+
+    // a forced move gains nothing from helpers
+    for (i = 1; i < search->num_threads && n > 1; i++)
+    {
+        started[i] = pthread_create(&threads[i], NULL, helper_run, &search->workers[i]) == 0;
+        used_threads += started[i];
+    }
+
+    worker_start(main_worker);
+    for (depth = 1; depth <= search->max_depth; depth++)
+    {
+        main_worker->horizon = 0;
+        main_worker->root_move = -1;
+        alpha_beta(main_worker, 0, depth, player_id, -INF, INF);
+        if (main_worker->stopped)
+            break;
+
+        if (main_worker->root_move >= 0)
+            best_move = main_worker->root_move;
+        main_worker->depth = depth;
+
+        // every line reached the end of the game: searching deeper cannot change anything
+        if (!main_worker->horizon)
+            break;
+    }
+
+    atomic_store(&search->done, 1);
+    for (i = 1; i < search->num_threads; i++)
+        if (started[i])
+            pthread_join(threads[i], NULL);
+
+    for (i = 0; i < search->num_threads; i++)
+    {
+        if (i > 0 && !started[i]) continue;
+        search->last.nodes += search->workers[i].nodes;
+        search->last.tt_probes += search->workers[i].tt_probes;
+        search->last.tt_hits += search->workers[i].tt_hits;
+    }
+    search->last.depth = main_worker->depth;
+    search->last.threads = used_threads;
+    search->last.seconds = now_seconds() - start;
+    search->total.nodes += search->last.nodes;
+    search->total.tt_probes += search->last.tt_probes;
+    search->total.tt_hits += search->last.tt_hits;
+    search->total.seconds += search->last.seconds;
+    search->total.searches++;
+    if (search->last.depth > search->total.depth)
+        search->total.depth = search->last.depth;
+    if (used_threads > search->total.threads)
+        search->total.threads = used_threads;
+
+    for (i = 0; i < n; i++)
+        if (moves[i].from * 4 + moves[i].dir == best_move)
+            break;
+    if (move) *move = moves[i < n ? i : 0];
+    return 1;
+}
+
+// Statistics of the latest search
+const SearchStats *search_last_stats(const Search *search)
+{
+    return &search->last;
+}
+
+// Statistics of all searches so far
+const SearchStats *search_total_stats(const Search *search)
+{
+    return &search->total;
+}
@@ -0,0 +1,64 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+// This header declares the alpha-beta search AI.
+// With 3 or 4 players it searches "paranoid": the player to move assumes every
+// opponent plays against it, which turns the game into a two-sided search.
+// Positions are cached in a Zobrist-hashed transposition table that lives as
+// long as the Search object, so it keeps helping from one move to the next.
+// With several threads the search is lazy SMP: all threads search the same
+// position and share the table without locks, and the first thread's
+// iterative deepening decides the move. Only a one-thread search gives the
+// same move every time.
+
+#include "board.h"
+
+// Deepest search in plies (one ply = one player's move).
+#define SEARCH_MAX_PLY 64
+
+// Highest number of threads one searcher uses.
+#define SEARCH_MAX_THREADS 64
+
+// Counters of one search, or summed over many.
+typedef struct {
+    long nodes;       // positions visited, by all threads
+    long tt_probes;   // transposition table lookups
+    long tt_hits;     // lookups that found the same position
+    int depth;        // deepest fully searched iteration (the maximum in totals)
+    long searches;    // moves chosen (totals only)
+    int threads;      // threads used (the maximum in totals)
+    double seconds;   // time spent searching
+} SearchStats;
+
+typedef struct Search Search;
+
+// Create a one-thread searcher with a transposition table of 2^tt_bits
+// entries (16 bytes each). Returns NULL on failure.
+Search *search_create(int tt_bits);
+
+// Free the searcher and its table.
+void search_free(Search *search);
+
+// Search with this many threads from the next move on (0 = one per CPU, at
+// most SEARCH_MAX_THREADS). Each thread gets its own working board.
+void search_set_threads(Search *search, int threads);
+
+// Stop iterative deepening at max_depth plies or after time_ms milliseconds (0 = no time limit).
+void search_set_limits(Search *search, int max_depth, int time_ms);
+
+// Raise (1) or clear (0) the stop flag; safe to call from another thread.
+// While it is raised every search returns as soon as it notices, with the
+// move of the deepest iteration it finished.
+void search_set_stop(Search *search, int stop);
+
+// Choose a move for player_id among num_players players (ids 1..num_players).
+// Returns 1 and the move (which penguin, and where to) if the player can move, 0 otherwise.
+int search_best_move(Search *search, const Board *board, int num_players, int player_id, Move *move);
+
+// Statistics of the most recent search.
+const SearchStats *search_last_stats(const Search *search);
+
+// Statistics summed over every search since the searcher was created.
+const SearchStats *search_total_stats(const Search *search);
+
+#endif
@@ -0,0 +1,127 @@
+/* This file implements the game sessions and session pools declared in session.h.
+   A session block is the Session struct, then its board (board_bytes), padded
+   to a cache line so sessions next to each other in a pool, used by different
+   threads, never share one. A pool is its header, the stack of free sessions
+   and then the sessions themselves, all from a single aligned allocation. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "session.h"
+
+// Alignment of every block, and of every session inside a pool
+#define SESSION_ALIGN 64
+
+struct SessionPool {
+    unsigned char *sessions;   // count sessions, stride bytes apart
+    size_t stride;
+    int count;
+    int free_count;
+    Session **free_list;       // sessions not in use, taken from the end
+};
+
+// Round n up to a multiple of a (a power of two)
+static size_t round_up(size_t n, size_t a)
+{
+    return (n + a - 1) & ~(a - 1);
+}
+
+// Offset of the board inside a session block, 8-byte aligned as board_layout wants
+static size_t board_offset(void)
+{
+    return round_up(sizeof(Session), 8);
+}
+
+// Bytes of one session block
+size_t session_bytes(int rows, int cols)
+{
+    return round_up(board_offset() + board_bytes(rows, cols), SESSION_ALIGN);
+}
+
+// Lay out an empty session in mem
+static Session *session_layout(void *mem, int rows, int cols)
+{
+    Session *session = mem;
+
+    memset(session, 0, sizeof(Session));
+    session->board = board_layout((unsigned char *)mem + board_offset(), rows, cols);
+    session->rows = rows;
+    session->cols = cols;
+    init_game(&session->game, session->board, session->players, 0, MODE_PVP);
+    return session;
+}
+
+// Create a session in its own aligned block
+Session *session_create(int rows, int cols)
+{
+    void *mem;
+
+    if (rows <= 0 || cols <= 0) return NULL;
+    mem = aligned_alloc(SESSION_ALIGN, session_bytes(rows, cols));
+    if (!mem) return NULL;
+    return session_layout(mem, rows, cols);
+}
+
+// Free a session; the board is part of its block
+void session_free(Session *session)
+{
+    free(session);
+}
+
+// Deal a new board and start a headless game on it, reusing the session's memory
+Game *session_reset(Session *session, Rng *rng, int num_players, int penguins, int mode)
+{
+    init_board(session->board, rng);
+    reset_players(session->players, num_players, penguins);
+    init_game(&session->game, session->board, session->players, num_players, mode);
+    session->game.quiet = 1;
+    return &session->game;
+}
+
+// Create count sessions in one block behind the pool header and the free stack
+SessionPool *session_pool_create(int count, int rows, int cols)
+{
+    size_t head, stride;
+    unsigned char *mem;
+    SessionPool *pool;
+    int i;
+
+    if (count <= 0 || rows <= 0 || cols <= 0) return NULL;
+
+    head = round_up(sizeof(SessionPool) + (size_t)count * sizeof(Session *), SESSION_ALIGN);
+    stride = session_bytes(rows, cols);
+    mem = aligned_alloc(SESSION_ALIGN, head + (size_t)count * stride);
+    if (!mem) return NULL;
+
+    pool = (SessionPool *)mem;
+    pool->free_list = (Session **)(pool + 1);
+    pool->sessions = mem + head;
+    pool->stride = stride;
+    pool->count = count;
+    pool->free_count = count;
+
+    // the first session is handed out first
+    for (i = 0; i < count; i++)
+        pool->free_list[count - 1 - i] = session_layout(pool->sessions + (size_t)i * stride, rows, cols);
+    return pool;
+}
+
+// Free the pool; its sessions go with it
+void session_pool_free(SessionPool *pool)
+{
+    free(pool);
+}
+
+// Pop a free session
+Session *session_pool_acquire(SessionPool *pool)
+{
+    if (pool->free_count == 0)
+        return NULL;
+    return pool->free_list[--pool->free_count];
+}
+
+// Push a session back; it keeps its memory for the next game
+void session_pool_release(SessionPool *pool, Session *session)
+{
+    if (pool->free_count < pool->count)
+        pool->free_list[pool->free_count++] = session;
+}
@@ -0,0 +1,54 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+// This header declares game sessions and the pool that hands them out.
+// A session is one game's whole state in one block: the Game, its players
+// and its board, laid out back to back. Resetting a session deals a new board
+// and starts a new game in the same memory, so a batch runner that keeps its
+// sessions allocates nothing per game. A pool carves many sessions of one
+// board size out of a single allocation and recycles them.
+
+#include "board.h"
+#include "players.h"
+#include "game.h"
+#include "rng.h"
+
+// One game's state; the board lives in the same block, right after the struct.
+typedef struct {
+    Game game;                       // points at players and board below
+    Player players[MAX_PLAYERS];     // seats; is_ai and name survive a reset
+    Board *board;                    // rows x cols, inside the session's block
+    int rows, cols;
+} Session;
+
+// Bytes one session of this board size takes, rounded up to a cache line.
+size_t session_bytes(int rows, int cols);
+
+// Create a session for boards of this size in one allocation. Returns NULL on failure.
+Session *session_create(int rows, int cols);
+
+// Free a session made by session_create (not one from a pool).
+void session_free(Session *session);
+
+// Start a new headless game in the session: deal the board from rng, give
+// every one of num_players seats penguins to place, and reset the game with
+// nothing attached (the caller attaches engines, replay and the rest).
+Game *session_reset(Session *session, Rng *rng, int num_players, int penguins, int mode);
+
+typedef struct SessionPool SessionPool;
+
+// Create a pool of count sessions for boards of this size, all in one
+// allocation. Returns NULL on failure.
+SessionPool *session_pool_create(int count, int rows, int cols);
+
+// Free the pool and every session in it.
+void session_pool_free(SessionPool *pool);
+
+// Take a session from the pool; NULL when all are in use. A pool is not
+// locked, so threads take their sessions before they start.
+Session *session_pool_acquire(SessionPool *pool);
+
+// Give a session back to the pool it came from.
+void session_pool_release(SessionPool *pool, Session *session);
+
+#endif
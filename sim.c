@@ -0,0 +1,608 @@
+/*
+ * Headless self-play simulator for Penguins Game.
+ * Runs many complete AI-vs-AI games through the real placement and movement
+ * phases in game.c with all terminal output switched off, then reports
+ * throughput, game length and per-seat score distributions.
+ * Games are spread over worker threads by the work-stealing scheduler in
+ * tournament.c; every worker keeps its own game session (session.h), RNG and
+ * statistics, which are merged only after all threads have finished. Sessions
+ * are reset in place for each game, so once the engines have warmed up a game
+ * allocates no memory.
+ *
+ * Usage: penguin-sim [-n games] [-p players] [-g penguins] [-s seed] [-S stream] [-t threads]
+ *                    [-a engine,engine,...] [-d depth] [-m ms]
+ *                    [-P playouts] [-T engine-threads] [-r replay-file]
+ *                    [-b ROWSxCOLS] [-e 0|1] [-l 0|1] [-D dataset-file] [-z 0|1]
+ * -a picks the AI engine per seat (greedy, search or mcts), -d and -m limit the
+ * search engine's depth and time per move, -m and -P limit the MCTS engine's
+ * time and playouts per move, and -T sets how many threads each search or
+ * MCTS player uses (1 by default, since the games already run on every core;
+ * a search with more than one thread no longer plays the same move every time).
+ * -r writes every game to a replay archive (see replay.h), and -b sets the
+ * board size (10x10 by default, up to BOARD_MAX_SIDE a side). Game g's board
+ * comes from seed + g on the given rng stream (0 by default).
+ * Every worker also has an endgame solver (endgame.h): search and MCTS seats
+ * play exact moves once their penguin is walled off, and a game in which every
+ * penguin is walled off is played out at once. -e 0 switches the solver off.
+ * Search and MCTS seats place their penguins with the placement evaluator
+ * (placement.h) and greedy seats on the first free tile; -l 0 makes every
+ * seat take the first free tile.
+ * -D writes every movement-phase position with its move and the final score
+ * margins to a training dataset (see dataset.h), in compressed blocks unless
+ * -z 0 is given.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include "board.h"
+#include "players.h"
+#include "game.h"
+#include "rng.h"
+#include "tournament.h"
+#include "search.h"
+#include "mcts.h"
+#include "endgame.h"
+#include "placement.h"
+#include "replay.h"
+#include "dataset.h"
+#include "session.h"
+#include "prof.h"
+
+// Transposition table size (2^bits entries) of each worker's search engine.
+#define SIM_TT_BITS 18
+
+// Tree nodes per thread of each worker's MCTS engine, and its default playouts per move.
+#define SIM_MCTS_NODES (1 << 16)
+#define SIM_MCTS_PLAYOUTS 2000
+
+// Width of one score histogram bucket, in fish.
+#define HIST_BUCKET 10
+#define HIST_BUCKETS 16
+
+// This struct accumulates the results of all simulated games.
+typedef struct {
+    long games;
+    long turns;
+    double score_sum[MAX_PLAYERS];
+    double score_sq_sum[MAX_PLAYERS];
+    int score_min[MAX_PLAYERS];
+    int score_max[MAX_PLAYERS];
+    long wins[MAX_PLAYERS];        // outright wins per seat
+    long ties;                     // games where the top score was shared
+    long fast_games;               // games finished by the endgame fast-forward
+    long fast_moves;               // moves it played
+    long hist[MAX_PLAYERS][HIST_BUCKETS];
+} SimStats;
+
+// Everything one worker thread touches while playing games.
+typedef struct {
+    Session *session;  // board, players and game, reset for every game
+    Rng rng;
+    Search *search;   // NULL unless some seat uses the search engine
+    Mcts *mcts;       // NULL unless some seat uses the MCTS engine
+    Endgame *endgame; // NULL if the endgame solver is switched off
+    Placement *placement; // NULL unless engine seats place with the evaluator
+    Replay *replay;   // NULL unless games are recorded
+    Dataset *dataset; // NULL unless training samples are written
+    SimStats stats;
+    char pad[64];  // keeps neighbouring workers' hot fields off each other's cache lines
+} SimWorker;
+
+// Settings shared read-only by all workers.
+typedef struct {
+    int num_players;
+    int penguins;              // penguins each player places
+    int rows, cols;            // board size
+    int engines[MAX_PLAYERS];  // AI_* engine of each seat
+    uint64_t seed;
+    uint64_t stream;           // rng stream every board is drawn from
+    SessionPool *sessions;     // one session per worker, in one block
+    SimWorker *workers;
+} SimContext;
+
+// Print usage and exit
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-n games] [-p players 2-%d] [-g penguins 1-%d] [-s seed] [-S stream]\n"
+                    "       [-t threads] [-a engine,engine,...] [-d depth] [-m ms] [-P playouts]\n"
+                    "       [-T engine-threads] [-r replay-file] [-b ROWSxCOLS] [-e 0|1] [-l 0|1]\n"
+                    "       [-D dataset-file] [-z 0|1]\n"
+                    "engines: greedy, search, mcts\n", prog, MAX_PLAYERS, MAX_PENGUINS);
+    exit(1);
+}
+
+// Add one finished game to the statistics
+static void record_game(SimStats *st, const Game *game)
+{
+    int i, best = -1, best_count = 0, best_seat = 0;
+
+    st->games++;
+    st->turns += game->turns;
+    st->fast_games += game->fast_forwarded > 0;
+    st->fast_moves += game->fast_forwarded;
+
+    for (i = 0; i < game->num_players; i++)
+    {
+        int s = game->players[i].score;
+        int b = s / HIST_BUCKET;
+
+        st->score_sum[i] += s;
+        st->score_sq_sum[i] += (double)s * s;
+        if (s < st->score_min[i]) st->score_min[i] = s;
+        if (s > st->score_max[i]) st->score_max[i] = s;
+        st->hist[i][b < HIST_BUCKETS ? b : HIST_BUCKETS - 1]++;
+
+        if (s > best) { best = s; best_count = 1; best_seat = i; }
+        else if (s == best) best_count++;
+    }
+
+    if (best_count == 1) st->wins[best_seat]++;
+    else st->ties++;
+}
+
+// Parse a comma separated engine list into engines[]; the last entry repeats for the remaining seats
+static int parse_engines(const char *arg, int *engines)
+{
+    int seat = 0, kind = AI_GREEDY;
+    const char *p = arg;
+
+    while (*p && seat < MAX_PLAYERS)
+    {
+        size_t len = strcspn(p, ",");
+        if (len == 6 && strncmp(p, "greedy", len) == 0) kind = AI_GREEDY;
+        else if (len == 6 && strncmp(p, "search", len) == 0) kind = AI_SEARCH;
+        else if (len == 4 && strncmp(p, "mcts", len) == 0) kind = AI_MCTS;
+        else return 0;
+
+        engines[seat++] = kind;
+        p += len;
+        if (*p == ',') p++;
+    }
+    while (seat < MAX_PLAYERS)
+        engines[seat++] = kind;
+    return 1;
+}
+
+// Read a board size written as ROWSxCOLS, each side 1..BOARD_MAX_SIDE
+static int parse_size(const char *arg, int *rows, int *cols)
+{
+    char tail;
+    return sscanf(arg, "%dx%d%c", rows, cols, &tail) == 2 &&
+           *rows >= 1 && *rows <= BOARD_MAX_SIDE && *cols >= 1 && *cols <= BOARD_MAX_SIDE;
+}
+
+// Name of an engine for the report
+static const char *engine_name(int kind)
+{
+    if (kind == AI_SEARCH) return "search";
+    if (kind == AI_MCTS) return "mcts";
+    return "greedy";
+}
+
+// Reset statistics so min/max start from the first game
+static void clear_stats(SimStats *st)
+{
+    int i;
+    memset(st, 0, sizeof(*st));
+    for (i = 0; i < MAX_PLAYERS; i++)
+    {
+        st->score_min[i] = 1 << 30;
+        st->score_max[i] = -1;
+    }
+}
+
+// Fold one worker's statistics into the total
+static void merge_stats(SimStats *into, const SimStats *from)
+{
+    int i, b;
+    into->games += from->games;
+    into->turns += from->turns;
+    into->ties += from->ties;
+    into->fast_games += from->fast_games;
+    into->fast_moves += from->fast_moves;
+    for (i = 0; i < MAX_PLAYERS; i++)
+    {
+        into->score_sum[i] += from->score_sum[i];
+        into->score_sq_sum[i] += from->score_sq_sum[i];
+        if (from->score_min[i] < into->score_min[i]) into->score_min[i] = from->score_min[i];
+        if (from->score_max[i] > into->score_max[i]) into->score_max[i] = from->score_max[i];
+        into->wins[i] += from->wins[i];
+        for (b = 0; b < HIST_BUCKETS; b++)
+            into->hist[i][b] += from->hist[i][b];
+    }
+}
+
+// Play game number g on the given worker (called from tournament threads)
+static void play_one(void *arg, int worker, long g)
+{
+    SimContext *ctx = (SimContext *)arg;
+    SimWorker *w = &ctx->workers[worker];
+    Game *game;
+
+    // game g always gets board seed + g, so results do not depend on which thread ran it
+    rng_seed_stream(&w->rng, ctx->seed + (uint64_t)g, ctx->stream);
+    game = session_reset(w->session, &w->rng, ctx->num_players, ctx->penguins, MODE_PVP);
+    game->search = w->search;
+    game->mcts = w->mcts;
+    game->endgame = w->endgame;
+    game->placement = w->placement;
+    game->replay = w->replay;
+    game->dataset = w->dataset;
+    game->seed = ctx->seed + (uint64_t)g;
+    game->stream = ctx->stream;
+    play_game(game);
+
+    record_game(&w->stats, game);
+}
+
+// Print per-thread load so imbalance is visible
+static void print_utilization(const WorkerReport *reports, int num_threads, double elapsed)
+{
+    int i;
+    printf("\nthread  games  steals  busy(s)  util\n");
+    for (i = 0; i < num_threads; i++)
+    {
+        printf("%6d %6ld %7ld %8.3f %5.1f%%\n",
+               i, reports[i].games, reports[i].steals, reports[i].busy,
+               elapsed > 0 ? 100.0 * reports[i].busy / elapsed : 0.0);
+    }
+}
+
+// Print search engine throughput summed over all workers
+static void print_search_report(const SimContext *ctx, int num_threads)
+{
+    SearchStats sum;
+    int i;
+
+    memset(&sum, 0, sizeof(sum));
+    for (i = 0; i < num_threads; i++)
+    {
+        const SearchStats *st;
+        if (!ctx->workers[i].search) continue;
+        st = search_total_stats(ctx->workers[i].search);
+        sum.nodes += st->nodes;
+        sum.tt_probes += st->tt_probes;
+        sum.tt_hits += st->tt_hits;
+        sum.searches += st->searches;
+        sum.seconds += st->seconds;
+        if (st->depth > sum.depth) sum.depth = st->depth;
+        if (st->threads > sum.threads) sum.threads = st->threads;
+    }
+    if (!sum.searches) return;
+
+    printf("\nsearch engine\n");
+    printf("moves        %ld\n", sum.searches);
+    printf("threads      %d per player\n", sum.threads);
+    printf("nodes        %ld (%.0f per move)\n", sum.nodes, (double)sum.nodes / sum.searches);
+    printf("nodes/sec    %.0f per player\n", sum.seconds > 0 ? sum.nodes / sum.seconds : 0.0);
+    printf("TT hit rate  %.1f%%\n", sum.tt_probes ? 100.0 * sum.tt_hits / sum.tt_probes : 0.0);
+    printf("max depth    %d\n", sum.depth);
+}
+
+// Print MCTS engine throughput summed over all workers
+static void print_mcts_report(const SimContext *ctx, int num_threads)
+{
+    MctsStats sum;
+    int i;
+
+    memset(&sum, 0, sizeof(sum));
+    for (i = 0; i < num_threads; i++)
+    {
+        const MctsStats *st;
+        if (!ctx->workers[i].mcts) continue;
+        st = mcts_total_stats(ctx->workers[i].mcts);
+        sum.playouts += st->playouts;
+        sum.nodes += st->nodes;
+        sum.searches += st->searches;
+        sum.seconds += st->seconds;
+    }
+    if (!sum.searches) return;
+
+    printf("\nmcts engine\n");
+    printf("moves        %ld\n", sum.searches);
+    printf("playouts     %ld (%.0f per move)\n", sum.playouts, (double)sum.playouts / sum.searches);
+    printf("playouts/sec %.0f per worker\n", sum.seconds > 0 ? sum.playouts / sum.seconds : 0.0);
+    printf("tree nodes   %.0f per move\n", (double)sum.nodes / sum.searches);
+}
+
+// Print endgame solver work summed over all workers
+static void print_endgame_report(const SimContext *ctx, const SimStats *total, int num_threads)
+{
+    EndgameStats sum;
+    int i;
+
+    memset(&sum, 0, sizeof(sum));
+    for (i = 0; i < num_threads; i++)
+    {
+        const EndgameStats *st;
+        if (!ctx->workers[i].endgame) continue;
+        st = endgame_total_stats(ctx->workers[i].endgame);
+        sum.solves += st->solves;
+        sum.given_up += st->given_up;
+        sum.nodes += st->nodes;
+        sum.memo_probes += st->memo_probes;
+        sum.memo_hits += st->memo_hits;
+    }
+    if (!sum.solves && !sum.given_up && !total->fast_games) return;
+
+    printf("\nendgame solver\n");
+    printf("solves       %ld (%ld given up)\n", sum.solves, sum.given_up);
+    printf("nodes        %ld (%.0f per solve)\n", sum.nodes,
+           sum.solves + sum.given_up ? (double)sum.nodes / (sum.solves + sum.given_up) : 0.0);
+    printf("memo hits    %.1f%%\n", sum.memo_probes ? 100.0 * sum.memo_hits / sum.memo_probes : 0.0);
+    printf("fast-forward %ld games, %ld moves\n", total->fast_games, total->fast_moves);
+}
+
+// Print how many training samples were written and how small they came out
+static void print_dataset_report(const SimContext *ctx, int num_threads, size_t record_bytes)
+{
+    uint64_t records = 0, bytes = 0;
+    int i;
+
+    for (i = 0; i < num_threads; i++)
+    {
+        if (!ctx->workers[i].dataset) return;
+        records += dataset_records_written(ctx->workers[i].dataset);
+        bytes += dataset_bytes_written(ctx->workers[i].dataset);
+    }
+    printf("\ndataset\n");
+    printf("records      %llu (%zu bytes each)\n", (unsigned long long)records, record_bytes);
+    printf("written      %llu bytes (%.2f per record)\n", (unsigned long long)bytes,
+           records ? (double)bytes / records : 0.0);
+}
+
+// Print the summary report
+static void print_report(const SimContext *ctx, const SimStats *st, int num_threads, double elapsed)
+{
+    int num_players = ctx->num_players;
+    int i, b;
+
+    printf("games        %ld\n", st->games);
+    printf("board        %dx%d\n", ctx->rows, ctx->cols);
+    printf("penguins     %d per player\n", ctx->penguins);
+    printf("seed         %llu stream %llu\n", (unsigned long long)ctx->seed, (unsigned long long)ctx->stream);
+    printf("threads      %d\n", num_threads);
+    printf("elapsed      %.3f s\n", elapsed);
+    printf("games/sec    %.1f\n", elapsed > 0 ? st->games / elapsed : 0.0);
+    printf("avg length   %.2f turns (placements + moves)\n",
+           st->games ? (double)st->turns / st->games : 0.0);
+    printf("ties         %ld\n\n", st->ties);
+
+    printf("seat engine    mean     sd    min   max   wins\n");
+    for (i = 0; i < num_players; i++)
+    {
+        double mean = st->score_sum[i] / st->games;
+        double var = st->score_sq_sum[i] / st->games - mean * mean;
+        printf("%4d %-6s %6.2f %6.2f %6d %5d %6ld\n",
+               i + 1, engine_name(ctx->engines[i]), mean, sqrt(var > 0 ? var : 0),
+               st->score_min[i], st->score_max[i], st->wins[i]);
+    }
+
+    printf("\nscore histogram (bucket = %d fish)\n", HIST_BUCKET);
+    printf("bucket ");
+    for (i = 0; i < num_players; i++)
+        printf("  seat%d", i + 1);
+    printf("\n");
+    for (b = 0; b < HIST_BUCKETS; b++)
+    {
+        long any = 0;
+        for (i = 0; i < num_players; i++)
+            any += st->hist[i][b];
+        if (!any) continue;
+
+        if (b == HIST_BUCKETS - 1) printf("%3d+   ", b * HIST_BUCKET);
+        else printf("%3d-%-3d", b * HIST_BUCKET, b * HIST_BUCKET + HIST_BUCKET - 1);
+        for (i = 0; i < num_players; i++)
+            printf(" %6ld", st->hist[i][b]);
+        printf("\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long num_games = 1000;
+    int num_players = 2;
+    int penguins = 1;
+    int num_threads = tournament_cpu_count();
+    int rows = 10, cols = 10;
+    SimContext ctx;
+    SimStats total;
+    WorkerReport *reports;
+    double elapsed;
+    int depth = 4, move_ms = 0, uses_search = 0;
+    int playouts = 0, engine_threads = 1, uses_mcts = 0;
+    int use_endgame = 1, use_placement = 1;
+    const char *replay_file = NULL, *dataset_file = NULL;
+    FILE *replay_out = NULL, *dataset_out = NULL;
+    int compress = 1;
+    int i, j;
+
+    ctx.seed = 1;
+    ctx.stream = 0;
+    parse_engines("greedy", ctx.engines);
+
+    // parse command line options
+    for (i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc) usage(argv[0]);
+        if (strcmp(argv[i], "-n") == 0) num_games = atol(argv[++i]);
+        else if (strcmp(argv[i], "-p") == 0) num_players = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-g") == 0) penguins = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0) ctx.seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-S") == 0) ctx.stream = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-t") == 0) num_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-a") == 0) { if (!parse_engines(argv[++i], ctx.engines)) usage(argv[0]); }
+        else if (strcmp(argv[i], "-d") == 0) depth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-m") == 0) move_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-P") == 0) playouts = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-T") == 0) engine_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-r") == 0) replay_file = argv[++i];
+        else if (strcmp(argv[i], "-D") == 0) dataset_file = argv[++i];
+        else if (strcmp(argv[i], "-z") == 0) compress = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-b") == 0) { if (!parse_size(argv[++i], &rows, &cols)) usage(argv[0]); }
+        else if (strcmp(argv[i], "-e") == 0) use_endgame = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-l") == 0) use_placement = atoi(argv[++i]);
+        else usage(argv[0]);
+    }
+    if (num_games < 1 || num_games > UINT32_MAX || num_players < 2 || num_players > MAX_PLAYERS ||
+        penguins < 1 || penguins > MAX_PENGUINS ||
+        num_threads < 1 || num_threads > MAX_WORKERS || engine_threads < 0 ||
+        engine_threads > MCTS_MAX_THREADS || engine_threads > SEARCH_MAX_THREADS ||
+        compress < 0 || compress > 1)
+        usage(argv[0]);
+
+    PROF_REPORT_AT_EXIT(PROF_FILE);
+
+    // without any budget MCTS gets a fixed playout count, which keeps runs reproducible
+    if (!move_ms && !playouts)
+        playouts = SIM_MCTS_PLAYOUTS;
+
+    ctx.num_players = num_players;
+    ctx.penguins = penguins;
+    ctx.rows = rows;
+    ctx.cols = cols;
+    for (i = 0; i < num_players; i++)
+    {
+        if (ctx.engines[i] == AI_SEARCH) uses_search = 1;
+        if (ctx.engines[i] == AI_MCTS) uses_mcts = 1;
+    }
+    if (replay_file)
+    {
+        replay_out = fopen(replay_file, "wb");
+        if (!replay_out)
+        {
+            fprintf(stderr, "Cannot open replay file %s.\n", replay_file);
+            return 1;
+        }
+    }
+    if (dataset_file)
+    {
+        dataset_out = fopen(dataset_file, "wb");
+        if (!dataset_out ||
+            !dataset_write_header(dataset_out, rows, cols, num_players, penguins, compress ? DATASET_COMPRESSED : 0))
+        {
+            fprintf(stderr, "Cannot write dataset file %s.\n", dataset_file);
+            return 1;
+        }
+    }
+    ctx.workers = calloc(num_threads, sizeof(SimWorker));
+    ctx.sessions = session_pool_create(num_threads, rows, cols);
+    reports = calloc(num_threads, sizeof(WorkerReport));
+    if (!ctx.workers || !ctx.sessions || !reports)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return 1;
+    }
+
+    // every worker takes its session and engines up front, so games allocate nothing
+    for (i = 0; i < num_threads; i++)
+    {
+        SimWorker *w = &ctx.workers[i];
+        w->session = session_pool_acquire(ctx.sessions);
+        if (uses_search)
+        {
+            w->search = search_create(SIM_TT_BITS);
+            if (!w->search)
+            {
+                fprintf(stderr, "Memory allocation failed.\n");
+                return 1;
+            }
+            search_set_limits(w->search, depth, move_ms);
+            search_set_threads(w->search, engine_threads);
+        }
+        if (uses_mcts)
+        {
+            w->mcts = mcts_create(engine_threads, SIM_MCTS_NODES);
+            if (!w->mcts)
+            {
+                fprintf(stderr, "Memory allocation failed.\n");
+                return 1;
+            }
+            mcts_set_limits(w->mcts, move_ms, playouts);
+        }
+        if (use_endgame)
+        {
+            w->endgame = endgame_create();
+            if (!w->endgame)
+            {
+                fprintf(stderr, "Memory allocation failed.\n");
+                return 1;
+            }
+        }
+        if (use_placement && (uses_search || uses_mcts))
+        {
+            w->placement = placement_create();
+            if (!w->placement)
+            {
+                fprintf(stderr, "Memory allocation failed.\n");
+                return 1;
+            }
+        }
+        if (replay_out)
+        {
+            w->replay = replay_create(replay_out);
+            if (!w->replay)
+            {
+                fprintf(stderr, "Memory allocation failed.\n");
+                return 1;
+            }
+        }
+        if (dataset_out)
+        {
+            w->dataset = dataset_create(dataset_out, rows, cols, num_players, penguins,
+                                        compress ? DATASET_COMPRESSED : 0);
+            if (!w->dataset)
+            {
+                fprintf(stderr, "Memory allocation failed.\n");
+                return 1;
+            }
+        }
+        for (j = 0; j < num_players; j++)
+        {
+            Player *pl = &w->session->players[j];
+            pl->is_ai = ctx.engines[j];
+            snprintf(pl->name, sizeof(pl->name), "AI%d", j + 1);
+        }
+        clear_stats(&w->stats);
+    }
+
+    elapsed = run_tournament(num_games, num_threads, play_one, &ctx, reports);
+
+    clear_stats(&total);
+    for (i = 0; i < num_threads; i++)
+        merge_stats(&total, &ctx.workers[i].stats);
+
+    // each worker's last, partly filled block goes out now that the threads are done
+    for (i = 0; i < num_threads; i++)
+        if (ctx.workers[i].dataset && !dataset_flush(ctx.workers[i].dataset))
+            fprintf(stderr, "Failed to write the dataset file.\n");
+
+    print_report(&ctx, &total, num_threads, elapsed);
+    print_search_report(&ctx, num_threads);
+    print_mcts_report(&ctx, num_threads);
+    print_endgame_report(&ctx, &total, num_threads);
+    print_dataset_report(&ctx, num_threads, dataset_record_bytes(rows, cols, num_players, penguins));
+    print_utilization(reports, num_threads, elapsed);
+
+    for (i = 0; i < num_threads; i++)
+    {
+        session_pool_release(ctx.sessions, ctx.workers[i].session);
+        search_free(ctx.workers[i].search);
+        mcts_free(ctx.workers[i].mcts);
+        endgame_free(ctx.workers[i].endgame);
+        placement_free(ctx.workers[i].placement);
+        replay_free(ctx.workers[i].replay);
+        dataset_free(ctx.workers[i].dataset);
+    }
+    if (replay_out && fclose(replay_out) != 0)
+        fprintf(stderr, "Failed to write the replay file.\n");
+    if (dataset_out && fclose(dataset_out) != 0)
+        fprintf(stderr, "Failed to write the dataset file.\n");
+    session_pool_free(ctx.sessions);
+    free(ctx.workers);
+    free(reports);
+    return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * Parallel search benchmark for Penguins Game.
+ * Builds test positions by dealing seeded boards, placing every penguin with
+ * the placement evaluator and playing a few greedy moves, then searches each
+ * position to a fixed depth with 1, 2, 4, ... threads, up to -T. Every run
+ * gets a fresh searcher, so the transposition table starts empty each time.
+ * For each thread count it reports the time to reach the depth summed over
+ * all positions, the nodes per second, the speedup in that time over one
+ * thread, the gain in nodes per second over one thread and how often the
+ * move matches the one-thread move. Helper threads
+ * always add nodes; only the time to depth shows whether they also help.
+ *
+ * Usage: penguin-smp [-n positions] [-d depth] [-T max-threads] [-b ROWSxCOLS]
+ *                    [-p players] [-g penguins] [-w moves] [-k tt-bits] [-s seed]
+ * By default 20 positions on 10x10 boards with 2 players of 2 penguins are
+ * searched to depth 12, with up to one thread per CPU. -w sets the greedy
+ * moves played before a position is searched (4 by default) and -k the
+ * transposition table size (2^20 entries by default).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "board.h"
+#include "rng.h"
+#include "search.h"
+#include "placement.h"
+
+#define SMP_MAX_POSITIONS 1000
+
+// One test position and the side to move in it.
+typedef struct {
+    Board *board;
+    int mover;
+    int move;          // one-thread result: from * 4 + direction
+} Position;
+
+// Print usage and exit
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-n positions] [-d depth] [-T max-threads] [-b ROWSxCOLS]\n"
+                    "       [-p players 2-%d] [-g penguins 1-%d] [-w moves] [-k tt-bits] [-s seed]\n",
+            prog, MAX_PLAYERS, MAX_PENGUINS);
+    exit(1);
+}
+
+// Read a board size written as ROWSxCOLS, each side 1..BOARD_MAX_SIDE
+static int parse_size(const char *arg, int *rows, int *cols)
+{
+    char tail;
+    return sscanf(arg, "%dx%d%c", rows, cols, &tail) == 2 &&
+           *rows >= 1 && *rows <= BOARD_MAX_SIDE && *cols >= 1 && *cols <= BOARD_MAX_SIDE;
+}
+
+// Deal a board, place every penguin with the evaluator and play greedy moves; returns the side to move, 0 if none
+static int build_position(Board *board, Placement *placement, uint64_t seed, int players, int penguins,
+                          int moves)
+{
+    Rng rng;
+    Move m;
+    MoveDelta delta;
+    int p, k, r, c, side = 1;
+
+    rng_seed(&rng, seed);
+    init_board(board, &rng);
+    for (k = 0; k < penguins; k++)
+        for (p = 1; p <= players; p++)
+            if (placement_choose(placement, board, &r, &c))
+                board_set(board, r, c, 0, p);
+
+    for (k = 0; k < moves; k++)
+    {
+        side = board_next_mover(board, players, side);
+        if (!side || !find_best_adjacent_move(board, side, &m))
+            return 0;
+        make_move(board, side, m.from, m.to, &delta);
+        side = side % players + 1;
+    }
+    return board_next_mover(board, players, side);
+}
+
+int main(int argc, char **argv)
+{
+    static Position pos[SMP_MAX_POSITIONS];
+    Placement *placement;
+    int num_positions = 20, depth = 12, max_threads, tt_bits = 20;
+    int rows = 10, cols = 10, players = 2, penguins = 2, warmup = 4;
+    uint64_t seed = 1;
+    double base_seconds = 0, base_rate = 0;
+    long n;
+    int i, threads, built = 0;
+
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+    max_threads = n > 0 ? (int)n : 1;
+
+    // parse command line options
+    for (i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc) usage(argv[0]);
+        if (strcmp(argv[i], "-n") == 0) num_positions = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0) depth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-T") == 0) max_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-p") == 0) players = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-g") == 0) penguins = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-w") == 0) warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-k") == 0) tt_bits = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0) seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-b") == 0) { if (!parse_size(argv[++i], &rows, &cols)) usage(argv[0]); }
+        else usage(argv[0]);
+    }
+    if (num_positions < 1 || num_positions > SMP_MAX_POSITIONS || depth < 1 || depth > SEARCH_MAX_PLY ||
+        max_threads < 1 || max_threads > SEARCH_MAX_THREADS || players < 2 || players > MAX_PLAYERS ||
+        penguins < 1 || penguins > MAX_PENGUINS || warmup < 0 || tt_bits < 10 || tt_bits > 30)
+        usage(argv[0]);
+
+    // positions where the side to move has a real choice
+    placement = placement_create();
+    if (!placement)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return 1;
+    }
+    for (i = 0; built < num_positions && i < 100 * num_positions; i++)
+    {
+        Move moves[MAX_MOVES];
+        Board *board = pos[built].board ? pos[built].board : create_board(rows, cols);
+        if (!board)
+        {
+            fprintf(stderr, "Memory allocation failed.\n");
+            return 1;
+        }
+        pos[built].board = board;
+        pos[built].mover = build_position(board, placement, seed + (uint64_t)i, players, penguins, warmup);
+        if (pos[built].mover && board_gen_moves(board, pos[built].mover, moves) > 1)
+            built++;
+    }
+    placement_free(placement);
+    if (built < num_positions)
+        free_board(pos[built].board);
+
+    printf("%d positions on %dx%d, %d players with %d penguins, %d greedy moves in, depth %d, 2^%d TT entries\n\n",
+           built, rows, cols, players, penguins, warmup, depth, tt_bits);
+    printf("threads   seconds       nodes   nodes/sec  speedup  nps gain  same move\n");
+
+    // powers of two, then -T itself
+    for (threads = 1; threads <= max_threads;
+         threads = threads < max_threads && threads * 2 > max_threads ? max_threads : threads * 2)
+    {
+        double seconds = 0, rate;
+        long nodes = 0;
+        int same = 0;
+
+        for (i = 0; i < built; i++)
+        {
+            Search *search = search_create(tt_bits);
+            const SearchStats *st;
+            Move m;
+
+            if (!search)
+            {
+                fprintf(stderr, "Memory allocation failed.\n");
+                return 1;
+            }
+            search_set_limits(search, depth, 0);
+            search_set_threads(search, threads);
+            search_best_move(search, pos[i].board, players, pos[i].mover, &m);
+            st = search_last_stats(search);
+            seconds += st->seconds;
+            nodes += st->nodes;
+            if (threads == 1)
+                pos[i].move = m.from * 4 + m.dir;
+            same += pos[i].move == m.from * 4 + m.dir;
+            search_free(search);
+        }
+        rate = seconds > 0 ? nodes / seconds : 0.0;
+        if (threads == 1)
+        {
+            base_seconds = seconds;
+            base_rate = rate;
+        }
+
+        printf("%7d %9.3f %11ld %11.0f %8.2f %9.2f %9.1f%%\n", threads, seconds, nodes, rate,
+               seconds > 0 ? base_seconds / seconds : 0.0, base_rate > 0 ? rate / base_rate : 0.0,
+               100.0 * same / built);
+        fflush(stdout);
+    }
+
+    for (i = 0; i < built; i++)
+        free_board(pos[i].board);
+    return 0;
+}
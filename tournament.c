@@ -0,0 +1,172 @@
+/* This file implements the work-stealing game scheduler declared in tournament.h.
+   Each worker owns a range [begin, end) of game numbers packed into one atomic
+   64-bit word. The owner takes games from the front; an idle worker steals the
+   back half of another worker's range with a single compare-and-swap, so no
+   lock is ever taken while games are running. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "tournament.h"
+
+// One worker's queue and bookkeeping, padded so workers never share a cache line.
+typedef struct {
+    _Alignas(64) _Atomic uint64_t range;  // begin in the low 32 bits, end in the high 32 bits
+    struct Tournament *t;
+    int id;
+    WorkerReport report;
+} Worker;
+
+typedef struct Tournament {
+    Worker workers[MAX_WORKERS];
+    int num_workers;
+    TournamentGameFn fn;
+    void *ctx;
+} Tournament;
+
+static inline uint64_t pack_range(uint32_t begin, uint32_t end)
+{
+    return (uint64_t)begin | ((uint64_t)end << 32);
+}
+
+static inline uint32_t range_begin(uint64_t r) { return (uint32_t)r; }
+static inline uint32_t range_end(uint64_t r) { return (uint32_t)(r >> 32); }
+
+// Seconds on a monotonic clock
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Number of CPUs available to this process
+int tournament_cpu_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) return 1;
+    if (n > MAX_WORKERS) return MAX_WORKERS;
+    return (int)n;
+}
+
+// Take the next game from the front of our own range. Returns 0 if it is empty.
+static int pop_own(Worker *w, uint32_t *game)
+{
+    uint64_t r = atomic_load_explicit(&w->range, memory_order_relaxed);
+    while (range_begin(r) < range_end(r))
+    {
+        uint64_t next = pack_range(range_begin(r) + 1, range_end(r));
+        if (atomic_compare_exchange_weak_explicit(&w->range, &r, next,
+                                                  memory_order_acquire, memory_order_relaxed))
+        {
+            *game = range_begin(r);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Steal the back half of some other worker's range into our own. Returns 0 if all are empty.
+static int steal(Worker *w)
+{
+    Tournament *t = w->t;
+    int k;
+
+    for (k = 1; k < t->num_workers; k++)
+    {
+        Worker *victim = &t->workers[(w->id + k) % t->num_workers];
+        uint64_t r = atomic_load_explicit(&victim->range, memory_order_relaxed);
+
+        while (range_begin(r) < range_end(r))
+        {
+            uint32_t left = range_end(r) - range_begin(r);
+            uint32_t take = (left + 1) / 2;
+            uint32_t split = range_end(r) - take;
+
+            if (atomic_compare_exchange_weak_explicit(&victim->range, &r,
+                                                      pack_range(range_begin(r), split),
+                                                      memory_order_acq_rel, memory_order_relaxed))
+            {
+                atomic_store_explicit(&w->range, pack_range(split, split + take), memory_order_release);
+                w->report.steals++;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Worker loop: drain our own range, then keep stealing until every range is empty
+static void *worker_main(void *arg)
+{
+    Worker *w = (Worker *)arg;
+    Tournament *t = w->t;
+    uint32_t game;
+
+    do
+    {
+        while (pop_own(w, &game))
+        {
+            double start = now_seconds();
+            t->fn(t->ctx, w->id, (long)game);
+            w->report.busy += now_seconds() - start;
+            w->report.games++;
+        }
+    } while (steal(w));
+
+    return NULL;
+}
+
+// Split the games evenly, run the workers and collect their reports.
+// The calling thread runs worker 0; if a thread fails to start, its games are stolen by the others.
+double run_tournament(long num_games, int num_threads,
+                      TournamentGameFn fn, void *ctx, WorkerReport *reports)
+{
+    static Tournament t;  // large and cache-line aligned, so kept out of the stack
+    pthread_t threads[MAX_WORKERS];
+    int started[MAX_WORKERS];
+    double start;
+    int i;
+
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > MAX_WORKERS) num_threads = MAX_WORKERS;
+    if (num_games < 0) num_games = 0;
+    if (num_games > UINT32_MAX) num_games = UINT32_MAX;
+
+    t.num_workers = num_threads;
+    t.fn = fn;
+    t.ctx = ctx;
+
+    for (i = 0; i < num_threads; i++)
+    {
+        Worker *w = &t.workers[i];
+        uint32_t begin = (uint32_t)(num_games * i / num_threads);
+        uint32_t end = (uint32_t)(num_games * (i + 1) / num_threads);
+
+        atomic_init(&w->range, pack_range(begin, end));
+        w->t = &t;
+        w->id = i;
+        w->report.games = 0;
+        w->report.steals = 0;
+        w->report.busy = 0;
+    }
+
+    start = now_seconds();
+    for (i = 1; i < num_threads; i++)
+        started[i] = pthread_create(&threads[i], NULL, worker_main, &t.workers[i]) == 0;
+
+    worker_main(&t.workers[0]);
+
+    for (i = 1; i < num_threads; i++)
+        if (started[i])
+            pthread_join(threads[i], NULL);
+
+    for (i = 0; i < num_threads; i++)
+        reports[i] = t.workers[i].report;
+
+    return now_seconds() - start;
+}
@@ -0,0 +1,29 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+// This header declares the multi-threaded game scheduler used by the simulator.
+// Games are numbered 0..num_games-1 and handed to worker threads; a worker
+// that runs out of games steals half of the remaining range of another one.
+
+// Called once per game on the worker that runs it. Must only touch state owned by that worker.
+typedef void (*TournamentGameFn)(void *ctx, int worker, long game);
+
+// What one worker did during a tournament.
+typedef struct {
+    long games;    // games played by this worker
+    long steals;   // successful steals from other workers
+    double busy;   // seconds spent inside the game callback
+} WorkerReport;
+
+// Highest number of worker threads run_tournament accepts.
+#define MAX_WORKERS 256
+
+// Number of CPUs available to this process, at least 1.
+int tournament_cpu_count(void);
+
+// Play all games on num_threads workers and fill reports[num_threads].
+// Returns wall-clock seconds. Only one tournament may run at a time.
+double run_tournament(long num_games, int num_threads,
+                      TournamentGameFn fn, void *ctx, WorkerReport *reports);
+
+#endif